@@ -56,7 +56,11 @@ class reader_top_block(gr.top_block):
     ######## Variables #########
     self.dac_rate = 1e6                 # DAC rate 
     self.adc_rate = 100e6/50            # ADC rate (2MS/s complex samples)
-    self.decim     = 5                    # Decimation (downsampling factor)
+    self.blf      = 40e3                 # Backscatter link frequency (up to 640 kHz with a faster ADC, TRcal = DR / BLF)
+    self.dr       = 0                    # Divide ratio: 0 -> 8, 1 -> 64/3
+    self.tari     = 24                   # Tari in us (6.25 to 25), data-1 of self.data1 Tari (1.5 to 2)
+    self.data1    = 2
+    self.decim    = max(1, int(self.adc_rate / self.blf / 10)) # Decimation (downsampling factor)
     # min seems to be .3 with max TX gain (60)
     # max is .7
     self.ampl     = 1                  # Output signal amplitude (signal power vary for different RFX900 cards)
@@ -67,21 +71,19 @@ class reader_top_block(gr.top_block):
     self.tx_gain   = 60                     # note that a setting of '0' will be ignored!!
 
     # Each FM0 symbol consists of ADC_RATE/BLF samples (2e6/40e3 = 50 samples)
-    # 10 samples per symbol after matched filtering and decimation
-    self.num_taps     = [1] * 25 # matched to half symbol period
+    # 10 samples per symbol after matched filtering (half symbol period) and decimation, both in the gate
 
     ######## File sinks for debugging (1 for each block) #########
     self.file_sink_source         = blocks.file_sink(gr.sizeof_gr_complex*1, "../misc/data/source", False)
-    self.file_sink_matched_filter = blocks.file_sink(gr.sizeof_gr_complex*1, "../misc/data/matched_filter", False)
     self.file_sink_gate           = blocks.file_sink(gr.sizeof_gr_complex*1, "../misc/data/gate", False)
     self.file_sink_decoder        = blocks.file_sink(gr.sizeof_gr_complex*1, "../misc/data/decoder", False)
     self.file_sink_reader         = blocks.file_sink(gr.sizeof_float*1,      "../misc/data/reader", False)
 
     ######## Blocks #########
-    self.matched_filter = filter.fir_filter_ccc(self.decim, self.num_taps);
-    self.gate            = rfid.gate(int(self.adc_rate/self.decim))
-    self.tag_decoder    = rfid.tag_decoder(int(self.adc_rate/self.decim))
-    self.reader          = rfid.reader(int(self.adc_rate/self.decim),int(self.dac_rate),self.select,self.mask)
+    self.session        = rfid.session()     # State shared by gate, tag_decoder and reader
+    self.gate            = rfid.gate(self.session, int(self.adc_rate/self.decim), self.decim)
+    self.tag_decoder    = rfid.tag_decoder(self.session, int(self.adc_rate/self.decim))
+    self.reader          = rfid.reader(self.session, int(self.adc_rate/self.decim),int(self.dac_rate),self.select,self.mask,self.blf,self.dr,self.tari,self.data1)
     self.amp              = blocks.multiply_const_ff(self.ampl)
     self.to_complex      = blocks.float_to_complex()
 
@@ -92,8 +94,7 @@ class reader_top_block(gr.top_block):
       self.u_sink()
 
       ######## Connections #########
-      self.connect(self.source,  self.matched_filter)
-      self.connect(self.matched_filter, self.gate)
+      self.connect(self.source,  self.gate)
 
       self.connect(self.gate, self.tag_decoder)
       self.connect((self.tag_decoder,0), self.reader)
@@ -113,8 +114,7 @@ class reader_top_block(gr.top_block):
       self.file_sink                  = blocks.file_sink(gr.sizeof_gr_complex*1,   "../misc/data/file_sink", False)     ## instead of uhd.usrp_sink
  
       ######## Connections ######### 
-      self.connect(self.file_source, self.matched_filter)
-      self.connect(self.matched_filter, self.gate)
+      self.connect(self.file_source, self.gate)
       self.connect(self.gate, self.tag_decoder)
       self.connect((self.tag_decoder,0), self.reader)
       self.connect(self.reader, self.amp)
@@ -124,8 +124,10 @@ class reader_top_block(gr.top_block):
     #File sinks for logging 
     #self.connect(self.gate, self.file_sink_gate)
     self.connect((self.tag_decoder,1), self.file_sink_decoder) # (Do not comment this line)
+
+    # Slot outcomes from the decoder drive the reader state machine
+    self.msg_connect(self.tag_decoder, "events", self.reader, "events")
     #self.connect(self.file_sink_reader, self.file_sink_reader)
-    #self.connect(self.matched_filter, self.file_sink_matched_filter)
 
 if __name__ == '__main__':
 
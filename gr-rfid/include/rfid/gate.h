@@ -23,6 +23,7 @@
 
 #include <rfid/api.h>
 #include <gnuradio/block.h>
+#include <rfid/session.h>
 
 namespace gr {
   namespace rfid {
@@ -32,6 +33,12 @@ namespace gr {
      * 
      * The samples related to a reader's command are blocked and consumed. 
      * Samples that belong to a Tag's message (RN16-EPC) are forwarded to the next block for further processing.
+     * The first and last sample of each message carry "burst_start" and "burst_end" stream tags,
+     * whose value is the offset of that sample in the gate input.
+     *
+     * With decim > 0 the gate takes the ADC samples at decim * sample_rate and applies the
+     * matched filter itself: a boxcar over half a tag bit, decimated by decim, in the same pass
+     * as DC tracking and command detection. With decim = 0 its input is already filtered.
      * \ingroup rfid
      *
      */
@@ -48,7 +55,7 @@ namespace gr {
        * class. rfid::gate::make is the public interface for
        * creating new instances.
        */
-      static sptr make(int sample_rate);
+      static sptr make(session::sptr reader_session, int sample_rate, int decim = 0);
 
     };
 
@@ -22,55 +22,80 @@
 #define INCLUDED_RFID_GLOBAL_VARS_H
 
 #include <rfid/api.h>
-#include <map>
+#include <vector>
+#include <atomic>
+#include <mutex>
 #include <sys/time.h>
+#include <cmath>
 
 namespace gr {
   namespace rfid {
 
+    class tag_table;
+
     enum STATUS               {RUNNING, TERMINATED};
     enum GEN2_LOGIC_STATUS  {SEND_SELECT, SEND_QUERY, SEND_ACK, SEND_QUERY_REP, IDLE, SEND_CW, START, SEND_QUERY_ADJUST, SEND_NAK_QR, SEND_NAK_Q, POWER_DOWN};
     enum GATE_STATUS        {GATE_OPEN, GATE_CLOSED, GATE_SEEK_RN16, GATE_SEEK_EPC};
     enum DECODER_STATUS     {DECODER_DECODE_RN16, DECODER_DECODE_EPC};
+    enum TIMING_MODE        {TIMING_GRID_SEARCH, TIMING_COARSE_TO_FINE, TIMING_EARLY_LATE};
+    enum Q_MODE             {Q_FIXED, Q_FLOATING, Q_SCHOUTE, Q_VOGT};
+    enum SLOT_OUTCOME       {SLOT_EMPTY, SLOT_SINGLE, SLOT_COLLISION};
+    enum Q_UPDATE           {Q_INCREMENT, Q_UNCHANGED, Q_DECREMENT};   // index of Q_UPDN
+    enum LATENCY_STAGE      {STAGE_GATE_OPEN, STAGE_GATE_CLOSE, STAGE_DECODED, STAGE_EMIT, STAGE_SINK, N_LATENCY_STAGES};
+    enum LATENCY_INTERVAL   {LAT_BURST, LAT_DECODE, LAT_DISPATCH, LAT_EMIT, LAT_TURNAROUND, N_LATENCY_INTERVALS};
     
     struct READER_STATS
     {
-      int n_queries_sent;
+      std::atomic<int> n_queries_sent;
 
-      int cur_inventory_round;
-      int cur_slot_number;
+      std::atomic<int> cur_inventory_round;
+      std::atomic<int> cur_slot_number;
 
       int max_slot_number;
       int max_inventory_round;
 
-      int n_epc_correct;
+      std::atomic<int> n_epc_correct;
       
 
       std::vector<int>  unique_tags_round;
-       std::map<int,int> tag_reads;    
+      std::vector<float> throughput_round;   // correct EPCs per second
+      tag_table * tags;                      // written by the decoder, listed by print_results
+      std::mutex tags_lock;
 
       struct timeval start, end; 
+      struct timeval round_start;
+      int round_start_epc;
     };
 
+    // Owned by an rfid::session, one per reader chain.
+    // Control fields are written and read by different scheduler threads.
     struct READER_STATE
     {
-      STATUS               status;
-      GEN2_LOGIC_STATUS   gen2_logic_status;
-      GATE_STATUS         gate_status;
-      DECODER_STATUS       decoder_status;
+      std::atomic<STATUS>             status;
+      std::atomic<GEN2_LOGIC_STATUS>  gen2_logic_status;
+      std::atomic<GATE_STATUS>        gate_status;
+      std::atomic<DECODER_STATUS>     decoder_status;
       READER_STATS         reader_stats;
 
-
-
-      std::vector<float> magn_squared_samples; // used for sync
-      int n_samples_to_ungate; // used by the GATE and DECODER block
+      std::vector<float> magn_squared_samples; // used for sync, sized by the gate for an EPC reply
+      std::atomic<int> n_samples_to_ungate; // used by the GATE and DECODER block
+      std::atomic<float> burst_noise;       // noise power in the DC window when the gate last opened
+      std::atomic<int> cycles_per_symbol;   // tag encoding of the current round: 1 FM0, 2/4/8 Miller
+      std::atomic<float> blf;               // BLF of the current round, Hz
+      std::atomic<float> tari;              // Tari of the current round, us
+      std::atomic<float> data1;             // data-1 length of the current round, in Tari
     };
 
     // CONSTANTS (READER CONFIGURATION)
 
-    // Fixed number of slots (2^(FIXED_Q))  
+    // Fixed number of slots (2^(FIXED_Q)), initial Q of the adaptive modes
     const int FIXED_Q              = 0;
 
+    // Step C of the floating-point Q algorithm, Gen2 Annex D range
+    const float Q_STEP             = 0.3;
+    const float Q_STEP_MIN         = 0.1;
+    const float Q_STEP_MAX         = 0.5;
+
     // Termination criteria
     // const int MAX_INVENTORY_ROUND = 50;
     const int MAX_NUM_QUERIES     = 1000;     // Stop after MAX_NUM_QUERIES have been sent
@@ -89,35 +114,45 @@ namespace gr {
     // Duration in us
     const int CW_D         = 250;    // Carrier wave
     const int P_DOWN_D     = 2000;    // power down
-    const int T1_D         = 240;    // Time from Interrogator transmission to Tag response (250 us)
+    const int T1_D         = 240;    // Time from Interrogator transmission to Tag response (250 us), default BLF
     const int T2_D         = 480;    // Time from Tag response to Interrogator transmission. Max value = 20.0 * T_tag = 500us 
-    const int T4_D         = 144;    // Minimum time between Interrogator commands = 2 x RTcal
+    const int T4_D         = 144;    // Minimum time between Interrogator commands = 2 x RTcal, default Tari
     const int TS_D         = 1500;   // TAG settling time (wakeup)
-    const int PW_D         = 12;      // Half Tari 
+    const int PW_D         = 12;      // Half Tari, default Tari
     const int DELIM_D       = 12;      // A preamble shall comprise a fixed-length start delimiter 12.5us +/-5%
-    const int TRCAL_D     = 200;    // BLF = DR/TRCAL => 40e3 = 8/TRCAL => TRCAL = 200us
-    const int RTCAL_D     = 72;      // 6*PW = 72us
+    const int TRCAL_D     = 200;    // BLF = DR/TRCAL => 40e3 = 8/TRCAL => TRCAL = 200us (default BLF)
+    const int RTCAL_D     = 72;      // 6*PW = 72us, default Tari and data-1
+    const float TARI_D     = 2 * PW_D; // Default Tari = data-0 (runtime setting)
+    const float TARI_MIN_D = 6.25;     // Gen2 Tari range
+    const float TARI_MAX_D = 25;
+    const float DATA1_T    = 2;        // Default data-1 length in Tari (runtime setting)
+    const float DATA1_MIN_T = 1.5;     // Gen2 data-1 range
+    const float DATA1_MAX_T = 2;
 
     const int NUM_PULSES_COMMAND = 5;       // Number of pulses to detect a reader command
     const int NUMBER_UNIQUE_TAGS = 100;      // Stop after NUMBER_UNIQUE_TAGS have been read 
+    const int LATENCY_SUMMARY_S  = 10;       // Seconds between turnaround latency summaries in the log
+    const int TAG_TABLE_CAPACITY = 16384;    // Tags per session before the tag table grows
 
 
     // Number of bits
     const int PILOT_TONE          = 12;  // Optional
     const int TAG_PREAMBLE_BITS  = 6;   // Number of preamble bits
+    const int MILLER_PILOT_BITS  = 4;   // Miller pilot without TRext, in symbols
     const int RN16_BITS          = 17;  // Dummy bit at the end
     const int EPC_BITS            = 129;  // PC + EPC + CRC16 + Dummy = 6 + 16 + 96 + 16 + 1 = 135
     const int QUERY_LENGTH        = 22;  // Query length in bits
     
-    const int T_READER_FREQ = 40e3;     // BLF = 40kHz
-    const float TAG_BIT_D   = 1.0/T_READER_FREQ * pow(10,6); // Duration in us
-    const int RN16_D        = (RN16_BITS + TAG_PREAMBLE_BITS) * TAG_BIT_D;
-    const int EPC_D          = (EPC_BITS  + TAG_PREAMBLE_BITS) * TAG_BIT_D;
+    const int T_READER_FREQ = 40e3;     // Default BLF = 40kHz (runtime setting)
+    const float TAG_BIT_D   = 1.0/T_READER_FREQ * pow(10,6); // Duration in us at the default BLF
+    const float BLF_MIN     = 40e3;     // Gen2 BLF range
+    const float BLF_MAX     = 640e3;
+    const float HALF_BIT_MIN_S = 2;     // Receive samples per FM0 half bit / Miller chip needed to decode a BLF
 
     // Query command (Q is set in code)
     const int QUERY_CODE[4] = {1,0,0,0};  // QUERY command
-    const int DR            = 0;          // TRcal divide ratio
-    const int M[2]          = {0,0};      // cycles per symbol
+    const int DR            = 0;          // TRcal divide ratio: 0 -> 8, 1 -> 64/3 (runtime setting)
+    const int TAG_ENCODING  = 1;          // cycles per symbol M: 1 FM0, 2/4/8 Miller (runtime setting)
     const int TREXT         = 0;          // pilot tone
     const int SEL_ALL[2]    = {0,0};      // which Tags respond to the Query: ALL TAGS
     const int SEL_SL[2]     = {1,1};      // which Tags respond to the Query: SELECTED TAGS
@@ -141,8 +176,8 @@ namespace gr {
     // QueryAdjust command
     const int QADJ_CODE[4]   = {1,0,0,1};
 
-    // 110 Increment by 1, 000 unchanged, 010 decrement by 1
-    const int Q_UPDN[3][3]  = { {1,1,0}, {0,0,0}, {0,1,0} };
+    // 110 Increment by 1, 000 unchanged, 011 decrement by 1
+    const int Q_UPDN[3][3]  = { {1,1,0}, {0,0,0}, {0,1,1} };
 
     // FM0 encoding preamble sequences
     const int TAG_PREAMBLE[] = {1,1,0,1,0,0,1,0,0,0,1,1};
@@ -151,12 +186,13 @@ namespace gr {
     const float THRESH_FRACTION = 0.75;     
     const int WIN_SIZE_D         = 250; 
 
-    // Duration in which dc offset is estimated (T1_D is 250)
+    // Duration in which dc offset is estimated (T1_D is 250), shorter with T1 at higher BLF
     const int DC_SIZE_D         = 120;
 
-    // Global variable
-    extern READER_STATE * reader_state;
-    extern void initialize_reader_state();
+    // RN16 slot classification, powers relative to the noise outside the reply
+    const float RN16_EMPTY_SNR      = 1;      // no tag if the data power is below (0 dB)
+    const float RN16_COLLISION_ERR  = 4;      // collision if the constellation error is above (6 dB)
+    const float RN16_COLLISION_EVM  = 0.1;    // and above this fraction of |h|^2 (second tag within 10 dB)
 
   } // namespace rfid
 } // namespace gr
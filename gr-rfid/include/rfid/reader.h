@@ -23,6 +23,7 @@
 
 #include <rfid/api.h>
 #include <gnuradio/block.h>
+#include <rfid/session.h>
 
 namespace gr {
   namespace rfid {
@@ -30,7 +31,8 @@ namespace gr {
     /*!
      * \brief The block is responsible for sending commands for transmission.
      *
-     * It moves between the following states.
+     * It moves between the following states. The block is idle until the
+     * tag_decoder posts the outcome of a slot on the "events" message port.
      *
      * \ingroup rfid
      *
@@ -48,7 +50,51 @@ namespace gr {
        * class. rfid::reader::make is the public interface for
        * creating new instances.
        */
-      static sptr make(int sample_rate, int dac_rate, bool select, const std::string &select_mask);
+      static sptr make(session::sptr reader_session, int sample_rate, int dac_rate, bool select, const std::string &select_mask,
+                       float blf = 40e3, int dr = 0, float tari = 24, float data1 = 2);
+
+      /*!
+       * \brief Select the slot count adaptation: 0 fixed Q (default), 1 floating-point Q (QueryAdjust),
+       * 2 Schoute and 3 Vogt backlog estimate per round.
+       */
+      virtual void set_q_mode(int mode) = 0;
+
+      /*!
+       * \brief Set the step C of the floating-point Q algorithm, 0.1 to 0.5 (default 0.3).
+       */
+      virtual void set_q_step(float c) = 0;
+
+      /*!
+       * \brief Select the tag encoding requested by the M bits of the Query: 1 FM0 (default),
+       * 2, 4 or 8 Miller subcarrier cycles per symbol. Takes effect at the next Query.
+       */
+      virtual void set_tag_encoding(int m) = 0;
+
+      /*!
+       * \brief Set the backscatter link frequency (Hz) and the divide ratio DR of the Query
+       * (0 -> 8, 1 -> 64/3); TRcal is DR / BLF. Takes effect at the next Query, together with
+       * the gate and decoder timing. BLF is 40 to 640 kHz; while TRcal is not 1.1 to 3 RTcal (see
+       * set_pie) or the BLF leaves fewer than 2 samples per half bit at sample_rate, the reader keeps
+       * its current link. The same holds for the link given to make().
+       */
+      virtual void set_link(float blf, int dr) = 0;
+
+      /*!
+       * \brief Set the PIE encoding of reader commands: Tari (data-0, 6.25 to 25 us) and the data-1
+       * length in Tari (1.5 to 2); RTcal is data-0 + data-1. Takes effect at the next Query, together
+       * with the gate pulse detection and T1. A shorter RTcal allows a higher BLF.
+       */
+      virtual void set_pie(float tari, float data1) = 0;
+
+      /*!
+       * \brief Cycle the inventory over n_antennas ports, dwell_rounds rounds or dwell_s seconds
+       * on each, whichever ends first (0 disables a limit); the port changes at the end of a round.
+       * Every port keeps its own Q and counters, reported by print_results. The first burst on a port
+       * carries an "antenna" stream tag with the port index, also published as {"antenna": port} on
+       * the "antenna" message port, for the radio to switch. Takes effect at the end of the current
+       * round, from port 0; the default is a single antenna.
+       */
+      virtual void set_antennas(int n_antennas, int dwell_rounds, float dwell_s) = 0;
 
     };
 
@@ -0,0 +1,117 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_SESSION_H
+#define INCLUDED_RFID_SESSION_H
+
+#include <rfid/api.h>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+
+namespace gr {
+  namespace rfid {
+
+    struct READER_STATE;
+    class latency_monitor;
+    class stats_board;
+
+    /*!
+     * \brief Snapshot of the inventory counters of a reader chain.
+     */
+    struct inventory_stats
+    {
+      double elapsed_s;                  // since the session was created
+      long n_queries_sent;               // Query, QueryRep and QueryAdjust
+      long n_rounds;                     // completed inventory rounds
+      long n_slots_empty;
+      long n_slots_single;
+      long n_slots_collided;
+      long n_epc_correct;
+      long n_epc_crc_fail;
+      long n_unique_tags;
+      double crc_failure_rate;           // of the EPC replies
+      double reads_per_s;                // correct EPCs since the start
+      double mean_round_reads_per_s;
+      double last_round_reads_per_s;
+    };
+
+    /*!
+     * \brief State shared by the gate, tag_decoder and reader blocks of one reader chain.
+     *
+     * Create one session per reader chain and pass it to the make()
+     * function of each of its blocks. Independent chains (e.g. one per
+     * antenna) use independent sessions and can run in the same flowgraph.
+     * Sessions own their state and are shared through sptr, never copied.
+     * \ingroup rfid
+     *
+     */
+    class RFID_API session : boost::noncopyable
+    {
+     public:
+      typedef boost::shared_ptr<session> sptr;
+
+      /*!
+       * \brief Return a shared_ptr to a new, initialized reader session.
+       */
+      static sptr make();
+      ~session();
+
+      READER_STATE * state() const { return d_state; }
+      latency_monitor * latency() const { return d_latency; }
+      stats_board * board() const { return d_board; }
+
+      /*!
+       * \brief Consistent copy of the inventory counters.
+       *
+       * Lock-free: the decoder and reader threads are never blocked,
+       * so the snapshot can be polled at any rate from any thread.
+       */
+      inventory_stats stats() const;
+
+      /*!
+       * \brief Turnaround latency of the reader chain, from tag reply to reader command.
+       *
+       * Intervals, in us: 0 burst (gate open to gate close), 1 decode (gate
+       * close to decoder event), 2 dispatch (event to reader emission),
+       * 3 emit (emission to samples handed to the sink), 4 turnaround
+       * (gate close to samples handed to the sink). Percentiles are upper
+       * bin edges of log histograms with four bins per octave. Another
+       * interval throws std::out_of_range.
+       */
+      std::string latency_summary() const;
+      float latency_percentile(int interval, float p) const;
+      float latency_max(int interval) const;
+      std::vector<int> latency_histogram(int interval) const;
+      long latency_slots() const;
+      long t2_violations() const;
+
+     private:
+      session();
+      READER_STATE * d_state;
+      latency_monitor * d_latency;
+      stats_board * d_board;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_SESSION_H */
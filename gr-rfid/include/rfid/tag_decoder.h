@@ -23,12 +23,26 @@
 
 #include <rfid/api.h>
 #include <gnuradio/block.h>
+#include <rfid/session.h>
 
 namespace gr {
   namespace rfid {
 
     /*!
-     * \brief <+description of block+>
+     * \brief Decodes the RN16 and EPC messages delimited by the gate.
+     *
+     * Each decoded RN16 is written to output 0 as one 16-bit item, first
+     * bit as MSB. The outcome of each message ("rn16", "rn16_fail" for an
+     * empty slot, "rn16_collision", "epc", "epc_fail") is posted on the
+     * "events" message port together with the gate input offset at which
+     * the message ended. RN16s of collided slots are not written.
+     *
+     * Every correct EPC is also posted on the "reads" message port as a
+     * dict: "epc" (PC + EPC bytes, u8vector), "rssi" (dB, backscatter
+     * power of the preamble channel estimate over the noise in the gate
+     * DC window), "phase" (rad, of the channel estimate) and "time" (ns
+     * since the Unix epoch). The same RSSI and phase are kept in the tag
+     * table of the session.
      * \ingroup rfid
      *
      */
@@ -45,7 +59,27 @@ namespace gr {
        * class. rfid::tag_decoder::make is the public interface for
        * creating new instances.
        */
-      static sptr make(int sample_rate);
+      static sptr make(session::sptr reader_session, int sample_rate);
+
+      /*!
+       * \brief Set the range of preamble offsets searched by the sync, in tag bits (default 1.5, at most an RN16).
+       */
+      virtual void set_sync_window(float tag_bits) = 0;
+
+      /*!
+       * \brief Enable parabolic interpolation of the preamble correlation peak (default off).
+       */
+      virtual void set_sync_interpolation(bool interpolate) = 0;
+
+      /*!
+       * \brief Select the EPC timing recovery: 0 grid search (default), 1 coarse-to-fine, 2 early-late loop.
+       */
+      virtual void set_timing_mode(int mode) = 0;
+
+      /*!
+       * \brief Enable empty/collided slot detection on RN16 bursts (default on).
+       */
+      virtual void set_collision_detection(bool detect) = 0;
     };
 
   } // namespace rfid
@@ -0,0 +1,124 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "antenna_scheduler.h"
+
+namespace gr {
+  namespace rfid {
+
+    antenna_scheduler::antenna_scheduler(int n_antennas, int dwell_rounds, float dwell_s)
+      : d_mode(Q_FIXED), d_c(Q_STEP), d_current(0), rounds(0), dwell_start(0)
+    {
+      set_antennas(n_antennas, dwell_rounds, dwell_s);
+    }
+
+    void antenna_scheduler::set_antennas(int n_antennas, int dwell_rounds, float dwell_s)
+    {
+      port p;
+      p.q_alg = q_algorithm(FIXED_Q, d_mode, d_c);
+      p.stats.n_rounds = p.stats.n_epc = 0;
+      p.stats.n_slots[SLOT_EMPTY] = p.stats.n_slots[SLOT_SINGLE] = p.stats.n_slots[SLOT_COLLISION] = 0;
+      p.stats.dwell_s = 0;
+      ports.assign(std::max(n_antennas, 1), p);
+
+      this->dwell_rounds = std::max(dwell_rounds, 0);
+      dwell_ns = dwell_s > 0 ? (uint64_t) (dwell_s * 1e9) : 0;
+      d_current = 0;
+      rounds = 0;
+    }
+
+    void antenna_scheduler::set_q_mode(Q_MODE mode)
+    {
+      d_mode = mode;
+      for (int i = 0; i < ports.size(); i++)
+        ports[i].q_alg.set_mode(mode);
+    }
+
+    void antenna_scheduler::set_q_step(float c)
+    {
+      d_c = c;
+      for (int i = 0; i < ports.size(); i++)
+        ports[i].q_alg.set_step(c);
+    }
+
+    void antenna_scheduler::start(uint64_t t_ns)
+    {
+      dwell_start = t_ns;
+      rounds = 0;
+    }
+
+    bool antenna_scheduler::end_round(uint64_t t_ns)
+    {
+      ports[d_current].stats.n_rounds++;
+      rounds++;
+      if (ports.size() == 1)
+        return false;
+
+      bool done = (dwell_rounds > 0 && rounds >= dwell_rounds) ||
+                  (dwell_ns > 0 && t_ns - dwell_start >= dwell_ns);
+      if (!done)
+        return false;
+
+      ports[d_current].stats.dwell_s += (t_ns - dwell_start) / 1e9;
+      d_current = (d_current + 1) % ports.size();
+      start(t_ns);
+      return true;
+    }
+
+    antenna_stats antenna_scheduler::stats(int i, uint64_t t_ns) const
+    {
+      antenna_stats s = ports[i].stats;
+      if (i == d_current && t_ns > dwell_start)
+        s.dwell_s += (t_ns - dwell_start) / 1e9;
+      return s;
+    }
+
+    float antenna_scheduler::reads_per_s(int i, uint64_t t_ns) const
+    {
+      antenna_stats s = stats(i, t_ns);
+      return s.dwell_s > 0 ? s.n_epc / s.dwell_s : 0;
+    }
+
+    std::string antenna_scheduler::summary(uint64_t t_ns) const
+    {
+      std::ostringstream out;
+      for (int i = 0; i < ports.size(); i++)
+      {
+        antenna_stats s = stats(i, t_ns);
+        out << "| Antenna " << i << (i == d_current ? "*" : " ")
+            << " : rounds " << s.n_rounds
+            << ", slots e/s/c " << s.n_slots[SLOT_EMPTY] << "/" << s.n_slots[SLOT_SINGLE] << "/" << s.n_slots[SLOT_COLLISION]
+            << ", EPC " << s.n_epc << ", Q " << ports[i].q_alg.q()
+            << std::fixed << std::setprecision(2) << ", " << s.dwell_s << " s"
+            << std::setprecision(1) << ", " << reads_per_s(i, t_ns) << " reads/s" << std::endl;
+        out.unsetf(std::ios::floatfield);
+      }
+      return out.str();
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,101 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_ANTENNA_SCHEDULER_H
+#define INCLUDED_RFID_ANTENNA_SCHEDULER_H
+
+#include <rfid/api.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "q_algorithm.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    // Inventory counters of one antenna port
+    struct antenna_stats
+    {
+      long n_rounds;                       // completed rounds
+      long n_slots[3];                     // by SLOT_OUTCOME
+      long n_epc;                          // correctly decoded EPCs
+      double dwell_s;                      // time spent on the port
+    };
+
+    /*!
+     * \brief Round-robin dwell of a reader over antenna ports.
+     *
+     * The reader stays on a port for dwell_rounds inventory rounds or
+     * dwell_s seconds, whichever comes first (0 disables a limit), and only
+     * moves on at the end of a round. Each port keeps its own Q algorithm
+     * and counters, so a port starts its next dwell from the Q it
+     * converged to. Times are ns of the latency_monitor clock.
+     */
+    class RFID_API antenna_scheduler
+    {
+      public:
+        antenna_scheduler(int n_antennas = 1, int dwell_rounds = 1, float dwell_s = 0);
+
+        // Restarts from port 0 with cleared counters; Q mode and step are kept
+        void set_antennas(int n_antennas, int dwell_rounds, float dwell_s);
+
+        int n_antennas() const { return ports.size(); }
+        int current() const { return d_current; }
+
+        // Q algorithm of the current port
+        q_algorithm & q_alg() { return ports[d_current].q_alg; }
+        const q_algorithm & q_alg() const { return ports[d_current].q_alg; }
+        void set_q_mode(Q_MODE mode);
+        void set_q_step(float c);
+
+        void count_slot(SLOT_OUTCOME outcome) { ports[d_current].stats.n_slots[outcome]++; }
+        void count_epc() { ports[d_current].stats.n_epc++; }
+
+        // Starts the dwell on the current port
+        void start(uint64_t t_ns);
+
+        // Closes a round; true if the reader moved to the next port
+        bool end_round(uint64_t t_ns);
+
+        // Counters of port i, including the ongoing dwell
+        antenna_stats stats(int i, uint64_t t_ns) const;
+        float reads_per_s(int i, uint64_t t_ns) const;
+
+        // One line per port: rounds, slots, EPCs, dwell time and read rate
+        std::string summary(uint64_t t_ns) const;
+
+      private:
+        struct port
+        {
+          q_algorithm q_alg;
+          antenna_stats stats;
+        };
+        std::vector<port> ports;
+        Q_MODE d_mode;
+        float d_c;
+        int d_current, dwell_rounds, rounds;   // rounds of the current dwell
+        uint64_t dwell_ns, dwell_start;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_ANTENNA_SCHEDULER_H */
@@ -0,0 +1,699 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Microbenchmarks of the reader stages, run outside the flowgraph.
+ *
+ *   bench-rfid [-j results.json] <suite>
+ *
+ *   decoder (default)   EPC decoding of synthetic replies per timing mode
+ *   <capture>           EPC bursts recorded at the gate output
+ *                       (fc32, 400 kS/s, one burst every n_samples_EPC samples)
+ *   crc                 CRC-16/CRC-5 throughput
+ *   sync                preamble sync, RN16 and EPC detection per burst
+ *   gate                gate tracking (scalar and VOLK) and the whole receive
+ *                       chain over the ADC samples of a simulated inventory
+ *   waveform            reader command emission
+ *   loop [n_tags]       closed-loop inventory against a tag_population (100 tags)
+ *   all                 every suite but <capture>
+ *
+ * With -j the results are also written as JSON, one record per printed
+ * row, to track regressions across releases.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdarg.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "boxcar_filter.h"
+#include "crc.h"
+#include "burst_gate.h"
+#include "replay_engine.h"
+#include "reply_decoder.h"
+#include "slot_logic.h"
+#include "tag_population.h"
+#include "waveform_cache.h"
+#include "rfid/global_vars.h"
+
+using namespace gr::rfid;
+
+namespace {
+
+  const int DAC_RATE = 1000000;
+  const int ADC_RATE = 2000000;
+  const int DECIM = 5;
+  const int S_RATE = ADC_RATE / DECIM;
+
+  const char * MODE_NAMES[] = {"grid", "coarse-to-fine", "early-late"};
+  const char * Q_MODE_NAMES[] = {"fixed", "floating", "schoute", "vogt"};
+
+  // One JSON record per printed row
+  struct record
+  {
+    std::string suite, name;
+    std::vector<std::pair<std::string, double> > values;
+  };
+  std::vector<record> records;
+
+  void add_record(const char * suite, const std::string & name,
+                  std::initializer_list<std::pair<std::string, double> > values)
+  {
+    record r;
+    r.suite = suite;
+    r.name = name;
+    r.values = values;
+    records.push_back(r);
+  }
+
+  std::string format(const char * fmt, ...)
+  {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return buf;
+  }
+
+  bool write_json(const char * path)
+  {
+    FILE * f = fopen(path, "w");
+    if (!f)
+    {
+      fprintf(stderr, "cannot write %s\n", path);
+      return false;
+    }
+    fprintf(f, "{\n  \"benchmarks\": [");
+    for (int i = 0; i < records.size(); i++)
+    {
+      fprintf(f, "%s\n    {\"suite\": \"%s\", \"name\": \"%s\"", i ? "," : "",
+              records[i].suite.c_str(), records[i].name.c_str());
+      for (int j = 0; j < records[i].values.size(); j++)
+      {
+        double v = records[i].values[j].second;
+        if (std::isfinite(v))
+          fprintf(f, ", \"%s\": %.6g", records[i].values[j].first.c_str(), v);
+        else
+          fprintf(f, ", \"%s\": null", records[i].values[j].first.c_str());
+      }
+      fprintf(f, "}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+    return true;
+  }
+
+  uint64_t cycles()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+  }
+
+  // Matched filter output (boxcar of a half-bit, decimation 5) of an FM0 EPC reply.
+  // Signal power is 1 per ADC sample, clock_offset is the relative tag bit period error.
+  void synth_reply(const std::vector<int> & bits, float clock_offset, float snr_db, int lead,
+                   std::mt19937 & rng, std::vector<gr_complex> & out)
+  {
+    std::normal_distribution<float> noise(0, std::sqrt(0.5f * std::pow(10.0f, -snr_db/10)));
+    std::uniform_real_distribution<float> phase(0, 2 * M_PI);
+    gr_complex h = std::polar(1.0f, phase(rng));
+
+    std::vector<int> levels;
+    for (int j = 0; j < 2 * TAG_PREAMBLE_BITS; j++)
+      levels.push_back(TAG_PREAMBLE[j] ? 1 : -1);
+    int level = 1;
+    for (int i = 0; i < bits.size(); i++)
+    {
+      level = -level;               // FM0: inversion at every bit boundary
+      levels.push_back(level);
+      if (bits[i] == 0)
+        level = -level;             // and in the middle of a data-0
+      levels.push_back(level);
+    }
+
+    float half_bit = ADC_RATE * TAG_BIT_D / 1e6 / 2 * (1 + clock_offset);
+    int taps = half_bit / (1 + clock_offset);
+    std::vector<gr_complex> adc((out.size() + 1) * DECIM + taps);
+    for (int n = 0; n < adc.size(); n++)
+    {
+      int k = (n - lead * DECIM) / half_bit;
+      float a = (n >= lead * DECIM && k < levels.size()) ? levels[k] : 0;
+      adc[n] = a * h + gr_complex(noise(rng), noise(rng));
+    }
+    for (int m = 0; m < out.size(); m++)
+    {
+      gr_complex sum(0,0);
+      for (int k = 0; k < taps; k++)
+        sum += adc[m * DECIM + k];
+      out[m] = sum / (float) taps;
+    }
+  }
+
+  struct decode_result
+  {
+    double ns, cycles;
+  };
+
+  // Sync, timing recovery and FM0 decision of one EPC burst
+  decode_result decode(reply_decoder & decoder, const std::vector<gr_complex> & in,
+                       std::vector<float> & magn_squared, epc_bits & bits)
+  {
+    for (int i = 0; i < in.size(); i++)
+      magn_squared[i] = std::norm(in[i]);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = cycles();
+    decoder.decode_epc(&in[0], in.size(), &magn_squared[0], magn_squared.size(), bits);
+    uint64_t c1 = cycles();
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+    decode_result r;
+    r.ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    r.cycles = c1 - c0;
+    return r;
+  }
+
+  void bench_synthetic(float n_samples_TAG_BIT, int n_samples_EPC)
+  {
+    const int N_REPLIES = 1000;
+    const float SNR_DB[] = {-6, -3, 0, 3};
+    const float CLOCK_OFFSET[] = {0, 0.005, -0.01, 0.02, -0.04};
+
+    reply_decoder decoder(n_samples_TAG_BIT);
+    std::vector<gr_complex> in(n_samples_EPC);
+    std::vector<float> magn_squared(n_samples_EPC);
+    epc_bits rx_bits;
+    std::vector<int> tx_bits(EPC_BITS);
+
+    printf("%-16s %8s %8s %10s %10s %10s %10s\n", "mode", "snr_db", "offset", "ns/epc", "cyc/epc", "ber", "epc_ok");
+    for (int mode = 0; mode < 3; mode++)
+    {
+      decoder.timing().set_mode((TIMING_MODE) mode);
+      for (int s = 0; s < sizeof(SNR_DB)/sizeof(SNR_DB[0]); s++)
+      {
+        for (int o = 0; o < sizeof(CLOCK_OFFSET)/sizeof(CLOCK_OFFSET[0]); o++)
+        {
+          // Same replies for every mode
+          std::mt19937 rng(s * 100 + o);
+          double ns = 0, cyc = 0;
+          long errors = 0;
+          int ok = 0;
+          for (int r = 0; r < N_REPLIES; r++)
+          {
+            for (int i = 0; i < EPC_BITS - 1; i++)
+              tx_bits[i] = rng() & 1;
+            tx_bits[EPC_BITS - 1] = 1;  // dummy bit
+            synth_reply(tx_bits, CLOCK_OFFSET[o], SNR_DB[s], rng() % (int) n_samples_TAG_BIT, rng, in);
+
+            decode_result d = decode(decoder, in, magn_squared, rx_bits);
+            ns += d.ns;
+            cyc += d.cycles;
+            int e = 0;
+            for (int i = 0; i < EPC_BITS - 1; i++)
+              e += rx_bits.get(i) != tx_bits[i];
+            errors += e;
+            ok += e == 0;
+          }
+          double ber = errors / (double) (N_REPLIES * (EPC_BITS - 1));
+          printf("%-16s %8.1f %8.3f %10.1f %10.0f %10.2e %10.3f\n", MODE_NAMES[mode], SNR_DB[s], CLOCK_OFFSET[o],
+                 ns / N_REPLIES, cyc / N_REPLIES, ber, ok / (double) N_REPLIES);
+          add_record("decoder", format("epc %s snr %.0f offset %.3f", MODE_NAMES[mode], SNR_DB[s], CLOCK_OFFSET[o]),
+                     {{"ns_per_epc", ns / N_REPLIES}, {"cycles_per_epc", cyc / N_REPLIES},
+                      {"ber", ber}, {"epc_ok", ok / (double) N_REPLIES}});
+        }
+      }
+    }
+  }
+
+  int bench_capture(const char * path, float n_samples_TAG_BIT, int n_samples_EPC)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+      fprintf(stderr, "cannot open %s\n", path);
+      return 1;
+    }
+    std::vector<gr_complex> samples;
+    gr_complex buf[4096];
+    while (file.read((char *) buf, sizeof(buf)) || file.gcount())
+      samples.insert(samples.end(), buf, buf + file.gcount() / sizeof(gr_complex));
+
+    int n_bursts = samples.size() / n_samples_EPC;
+    reply_decoder decoder(n_samples_TAG_BIT);
+    std::vector<gr_complex> in(n_samples_EPC);
+    std::vector<float> magn_squared(n_samples_EPC);
+    epc_bits rx_bits;
+
+    // Without ground truth the CRC pass rate stands in for the BER
+    printf("%-16s %8s %10s %10s %10s\n", "mode", "bursts", "ns/epc", "cyc/epc", "crc_ok");
+    for (int mode = 0; mode < 3; mode++)
+    {
+      decoder.timing().set_mode((TIMING_MODE) mode);
+      double ns = 0, cyc = 0;
+      int ok = 0;
+      for (int b = 0; b < n_bursts; b++)
+      {
+        memcpy(&in[0], &samples[b * n_samples_EPC], sizeof(gr_complex) * n_samples_EPC);
+        decode_result d = decode(decoder, in, magn_squared, rx_bits);
+        ns += d.ns;
+        cyc += d.cycles;
+        ok += crc16::check(rx_bits.words(), epc_bits::n_bits);
+      }
+      printf("%-16s %8d %10.1f %10.0f %10.3f\n", MODE_NAMES[mode], n_bursts,
+             ns / std::max(n_bursts, 1), cyc / std::max(n_bursts, 1), ok / (double) std::max(n_bursts, 1));
+      add_record("capture", format("epc %s", MODE_NAMES[mode]),
+                 {{"bursts", (double) n_bursts}, {"ns_per_epc", ns / std::max(n_bursts, 1)},
+                  {"cycles_per_epc", cyc / std::max(n_bursts, 1)}, {"crc_ok", ok / (double) std::max(n_bursts, 1)}});
+    }
+    return 0;
+  }
+
+  template <typename F>
+  double time_ns(int n_runs, F f)
+  {
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < n_runs; r++)
+      f();
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / n_runs;
+  }
+
+  // CRC-16 over EPC replies and a long buffer, and CRC-5 over Query commands
+  void bench_crc()
+  {
+    const int N_RUNS = 100000;
+    const int N_LONG = 4096;
+    std::mt19937 rng(0);
+
+    epc_bits epc;
+    for (int i = 0; i < epc_bits::n_bits; i++)
+      epc.set(i, rng() & 1);
+    std::vector<uint8_t> bytes(N_LONG);
+    for (int i = 0; i < N_LONG; i++)
+      bytes[i] = rng();
+    std::vector<float> query(17);
+    for (int i = 0; i < 17; i++)
+      query[i] = rng() & 1;
+    uint64_t query_value = 0;
+    for (int i = 0; i < 17; i++)
+      query_value = (query_value << 1) | (query[i] != 0);
+
+    // Keeps the results live
+    volatile unsigned sink = 0;
+    const uint16_t (*t)[256] = crc16::tables.t;
+
+    printf("%-28s %10s %10s\n", "crc", "bits", "ns/call");
+    double ns;
+
+    ns = time_ns(N_RUNS, [&]() {
+      uint16_t crc = crc16::PRESET;
+      for (int i = 0; i < epc_bits::n_bits - 16; i++)
+        crc = crc16::update_bit(crc, epc.get(i));
+      sink += crc;
+    });
+    printf("%-28s %10d %10.1f\n", "crc16 epc bitwise", epc_bits::n_bits - 16, ns);
+    add_record("crc", "crc16 epc bitwise", {{"bits", (double) epc_bits::n_bits - 16}, {"ns_per_call", ns}});
+
+    ns = time_ns(N_RUNS, [&]() { sink += crc16::check(epc.words(), epc_bits::n_bits); });
+    printf("%-28s %10d %10.1f\n", "crc16 epc packed", epc_bits::n_bits - 16, ns);
+    add_record("crc", "crc16 epc packed", {{"bits", (double) epc_bits::n_bits - 16}, {"ns_per_call", ns}});
+
+    ns = time_ns(N_RUNS / 100, [&]() {
+      uint16_t crc = crc16::PRESET;
+      for (int i = 0; i < N_LONG; i++)
+        crc = (uint16_t) (crc << 8) ^ t[0][(crc >> 8) ^ bytes[i]];
+      sink += crc;
+    });
+    printf("%-28s %10d %10.1f  (%.0f MB/s)\n", "crc16 bytewise table", 8 * N_LONG, ns, N_LONG * 1e3 / ns);
+    add_record("crc", "crc16 bytewise table", {{"bits", 8.0 * N_LONG}, {"ns_per_call", ns}, {"mb_per_s", N_LONG * 1e3 / ns}});
+
+    ns = time_ns(N_RUNS / 100, [&]() { sink += crc16::update(crc16::PRESET, &bytes[0], N_LONG); });
+    printf("%-28s %10d %10.1f  (%.0f MB/s)\n", "crc16 slicing-by-8", 8 * N_LONG, ns, N_LONG * 1e3 / ns);
+    add_record("crc", "crc16 slicing-by-8", {{"bits", 8.0 * N_LONG}, {"ns_per_call", ns}, {"mb_per_s", N_LONG * 1e3 / ns}});
+
+    ns = time_ns(N_RUNS, [&]() { sink += crc5::update_bits(crc5::PRESET, &query[0], 17); });
+    printf("%-28s %10d %10.1f\n", "crc5 query float bits", 17, ns);
+    add_record("crc", "crc5 query float bits", {{"bits", 17}, {"ns_per_call", ns}});
+
+    ns = time_ns(N_RUNS, [&]() { sink += crc5::compute(query_value, 17); });
+    printf("%-28s %10d %10.1f\n", "crc5 query packed", 17, ns);
+    add_record("crc", "crc5 query packed", {{"bits", 17}, {"ns_per_call", ns}});
+  }
+
+
+  // Preamble sync and reply detection of one burst each
+  void bench_sync(float n_samples_TAG_BIT, int n_samples_EPC)
+  {
+    const int N_RUNS = 20000;
+    int n_samples_RN16 = (RN16_BITS + TAG_PREAMBLE_BITS) * n_samples_TAG_BIT + 2*n_samples_TAG_BIT;
+    std::mt19937 rng(0);
+
+    std::vector<int> rn16_tx(RN16_BITS), epc_tx(EPC_BITS);
+    for (int i = 0; i < RN16_BITS; i++)
+      rn16_tx[i] = i == RN16_BITS - 1 || (rng() & 1);
+    for (int i = 0; i < EPC_BITS; i++)
+      epc_tx[i] = i == EPC_BITS - 1 || (rng() & 1);
+    std::vector<gr_complex> rn16(n_samples_RN16), epc(n_samples_EPC);
+    synth_reply(rn16_tx, 0, 3, 4, rng, rn16);
+    synth_reply(epc_tx, 0, 3, 4, rng, epc);
+    std::vector<float> magn_squared(n_samples_EPC);
+    for (int i = 0; i < n_samples_EPC; i++)
+      magn_squared[i] = std::norm(epc[i]);
+
+    reply_decoder decoder(n_samples_TAG_BIT);
+    rn16_bits rn16_rx;
+    epc_bits epc_rx;
+    gr_complex h;
+    volatile float sink = 0;
+
+    printf("%-28s %10s %10s\n", "stage", "samples", "ns/call");
+    double ns;
+
+    ns = time_ns(N_RUNS, [&]() { sink += decoder.sync().sync(&rn16[0], rn16.size(), h); });
+    printf("%-28s %10d %10.1f\n", "preamble sync rn16", n_samples_RN16, ns);
+    add_record("sync", "preamble sync rn16", {{"samples", (double) n_samples_RN16}, {"ns_per_call", ns}});
+
+    ns = time_ns(N_RUNS, [&]() { sink += decoder.sync().sync(&epc[0], epc.size(), h); });
+    printf("%-28s %10d %10.1f\n", "preamble sync epc", n_samples_EPC, ns);
+    add_record("sync", "preamble sync epc", {{"samples", (double) n_samples_EPC}, {"ns_per_call", ns}});
+
+    ns = time_ns(N_RUNS, [&]() { sink += decoder.decode_rn16(&rn16[0], rn16.size(), rn16_rx); });
+    printf("%-28s %10d %10.1f\n", "detect rn16", n_samples_RN16, ns);
+    add_record("sync", "detect rn16", {{"samples", (double) n_samples_RN16}, {"ns_per_call", ns}});
+
+    ns = time_ns(N_RUNS, [&]() {
+      decoder.decode_epc(&epc[0], epc.size(), &magn_squared[0], magn_squared.size(), epc_rx);
+      sink += crc16::check(epc_rx.words(), epc_bits::n_bits);
+    });
+    printf("%-28s %10d %10.1f\n", "detect epc + crc", n_samples_EPC, ns);
+    add_record("sync", "detect epc + crc", {{"samples", (double) n_samples_EPC}, {"ns_per_call", ns}});
+  }
+
+  // Emission of each reader command with the carrier that follows it
+  void bench_waveform()
+  {
+    const int N_RUNS = 20000;
+    waveform_cache waveforms(DAC_RATE);
+    std::vector<float> out(std::max(waveforms.max_burst_size(), waveforms.n_cwsettle_s));
+    volatile int sink = 0;
+    int n = 0;
+
+    printf("%-28s %10s %10s %10s\n", "command", "samples", "ns/call", "MS/s");
+    double ns;
+
+    ns = time_ns(N_RUNS, [&]() { sink += n = waveforms.emit_query(query_word(false, n & 0xf), &out[0]); });
+    printf("%-28s %10d %10.1f %10.0f\n", "query", n, ns, n * 1e3 / ns);
+    add_record("waveform", "query", {{"samples", (double) n}, {"ns_per_call", ns}, {"ms_per_s", n * 1e3 / ns}});
+
+    ns = time_ns(N_RUNS, [&]() { sink += n = waveforms.emit_query_rep(&out[0]); });
+    printf("%-28s %10d %10.1f %10.0f\n", "query rep", n, ns, n * 1e3 / ns);
+    add_record("waveform", "query rep", {{"samples", (double) n}, {"ns_per_call", ns}, {"ms_per_s", n * 1e3 / ns}});
+
+    ns = time_ns(N_RUNS, [&]() { sink += n = waveforms.emit_query_adjust(Q_INCREMENT, &out[0]); });
+    printf("%-28s %10d %10.1f %10.0f\n", "query adjust", n, ns, n * 1e3 / ns);
+    add_record("waveform", "query adjust", {{"samples", (double) n}, {"ns_per_call", ns}, {"ms_per_s", n * 1e3 / ns}});
+
+    uint16_t rn16 = 0;
+    ns = time_ns(N_RUNS, [&]() { sink += n = waveforms.emit_ack(rn16 += 0x9e37, &out[0]); });
+    printf("%-28s %10d %10.1f %10.0f\n", "ack", n, ns, n * 1e3 / ns);
+    add_record("waveform", "ack", {{"samples", (double) n}, {"ns_per_call", ns}, {"ms_per_s", n * 1e3 / ns}});
+
+    ns = time_ns(N_RUNS, [&]() { sink += n = waveforms.emit_settle(&out[0]); });
+    printf("%-28s %10d %10.1f %10.0f\n", "settle", n, ns, n * 1e3 / ns);
+    add_record("waveform", "settle", {{"samples", (double) n}, {"ns_per_call", ns}, {"ms_per_s", n * 1e3 / ns}});
+  }
+
+  struct loop_result
+  {
+    int n_tags_read, n_slots;
+    long n_samples;            // ADC samples of the whole inventory
+    double sim_ns, rx_ns;      // tag simulation, receive chain
+  };
+
+  /*
+   * Inventory of a simulated population with the slot logic of reader_impl:
+   * ACK after a single RN16, then the command of slot_logic. Optionally keeps
+   * the ADC samples.
+   */
+  loop_result closed_loop(int n_tags, Q_MODE mode, std::vector<gr_complex> * capture = NULL)
+  {
+    waveform_cache waveforms(DAC_RATE);
+    tag_population population(DAC_RATE, ADC_RATE, n_tags, 1);
+    replay_engine engine(ADC_RATE, DECIM);
+    slot_logic slots;
+    slots.q_alg() = q_algorithm(4, mode);
+
+    std::vector<float> tx(std::max(waveforms.max_burst_size(), waveforms.n_cwsettle_s));
+    std::vector<gr_complex> rx(tx.size() * population.interpolation());
+    loop_result r = loop_result();
+
+    auto send = [&](int n) {
+      int n_rx = n * population.interpolation();
+      std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+      population.process(&tx[0], n, &rx[0]);
+      std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+      engine.process(&rx[0], n_rx);
+      std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+      r.sim_ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+      r.rx_ns += std::chrono::duration<double, std::nano>(t2 - t1).count();
+      r.n_samples += n_rx;
+      if (capture)
+        capture->insert(capture->end(), rx.begin(), rx.begin() + n_rx);
+    };
+
+    long before[3];
+    memcpy(before, engine.stats().n_rn16, sizeof(before));
+    send(waveforms.emit_settle(&tx[0]));
+    send(waveforms.emit_query(query_word(false, slots.q_alg().q()), &tx[0]));
+    while (population.n_tags_read() < n_tags && r.n_slots < 20 * n_tags)
+    {
+      SLOT_OUTCOME outcome = SLOT_EMPTY;
+      for (int o = SLOT_EMPTY; o <= SLOT_COLLISION; o++)
+        if (engine.stats().n_rn16[o] > before[o])
+          outcome = (SLOT_OUTCOME) o;
+      if (outcome == SLOT_SINGLE)
+        send(waveforms.emit_ack(engine.last_rn16().field(0, 16), &tx[0]));
+      r.n_slots++;
+
+      memcpy(before, engine.stats().n_rn16, sizeof(before));
+      // A single antenna never moves to START
+      switch (slots.end_slot(outcome, 0))
+      {
+        case SEND_QUERY_ADJUST:
+          send(waveforms.emit_query_adjust(slots.q_change(), &tx[0]));
+          break;
+        case SEND_QUERY_REP:
+          send(waveforms.emit_query_rep(&tx[0]));
+          break;
+        default:
+          send(waveforms.emit_query(query_word(false, slots.q_alg().q()), &tx[0]));
+          break;
+      }
+    }
+    r.n_tags_read = population.n_tags_read();
+    return r;
+  }
+
+  void bench_loop(int n_tags)
+  {
+    const Q_MODE MODES[] = {Q_FLOATING, Q_SCHOUTE, Q_VOGT};
+
+    printf("%-10s %6s %6s %7s %9s %9s %10s %10s %10s\n", "q_mode", "tags", "read", "slots",
+           "air_s", "tags/s", "rx_MS/s", "rx_xrt", "sim_MS/s");
+    for (int m = 0; m < 3; m++)
+    {
+      loop_result r = closed_loop(n_tags, MODES[m]);
+      double air_s = r.n_samples / (double) ADC_RATE;
+      double rx_rate = r.n_samples * 1e3 / r.rx_ns;
+      printf("%-10s %6d %6d %7d %9.3f %9.1f %10.1f %10.1f %10.1f\n", Q_MODE_NAMES[MODES[m]], n_tags,
+             r.n_tags_read, r.n_slots, air_s, r.n_tags_read / air_s, rx_rate, rx_rate * 1e6 / ADC_RATE,
+             r.n_samples * 1e3 / r.sim_ns);
+      add_record("loop", format("inventory %d tags %s", n_tags, Q_MODE_NAMES[MODES[m]]),
+                 {{"tags_read", (double) r.n_tags_read}, {"slots", (double) r.n_slots}, {"air_s", air_s},
+                  {"tags_per_air_s", r.n_tags_read / air_s}, {"rx_ms_per_s", rx_rate},
+                  {"rx_x_real_time", rx_rate * 1e6 / ADC_RATE}, {"sim_ms_per_s", r.n_samples * 1e3 / r.sim_ns}});
+    }
+  }
+
+  // Gate on the matched filter output of a simulated inventory, then the whole receive chain
+  void bench_gate()
+  {
+    std::vector<gr_complex> adc;
+    closed_loop(100, Q_FLOATING, &adc);
+
+    // Boxcar over half a tag bit and decimation: FIR with one MAC per tap, as fir_filter_ccc, and the running sum of the gate
+    int taps = ADC_RATE * TAG_BIT_D / 1e6 / 2;
+    std::vector<gr_complex> in(adc.size() / DECIM - taps);
+    printf("%-28s %10s %10s %10s %10s\n", "matched filter", "samples", "", "ns/sample", "MS/s");
+    double ns_fir = time_ns(1, [&]() {
+      for (int m = 0; m < in.size(); m++)
+      {
+        gr_complex sum(0,0);
+        for (int k = 0; k < taps; k++)
+          sum += gr_complex(1,0) * adc[m * DECIM + k];
+        in[m] = sum;
+      }
+    });
+    std::vector<gr_complex> fir(in);
+    boxcar_filter boxcar(taps, DECIM);
+    double ns_boxcar = time_ns(1, [&]() { boxcar.filter(&adc[0], in.size(), &in[0]); });
+    float max_error = 0;
+    for (int m = 0; m < in.size(); m++)
+      max_error = std::max(max_error, std::abs(in[m] - fir[m]));
+    const char * FILTER_NAMES[2] = {"fir (adc)", "running sum (adc)"};
+    const double FILTER_NS[2] = {ns_fir, ns_boxcar};
+    for (int f = 0; f < 2; f++)
+    {
+      int n_adc = in.size() * DECIM;
+      printf("%-28s %10d %10s %10.2f %10.1f\n", FILTER_NAMES[f], n_adc, "", FILTER_NS[f] / n_adc, n_adc * 1e3 / FILTER_NS[f]);
+      add_record("gate", FILTER_NAMES[f], {{"samples", (double) n_adc}, {"ns_per_sample", FILTER_NS[f] / n_adc},
+                                           {"ms_per_s", n_adc * 1e3 / FILTER_NS[f]}, {"max_error", max_error}});
+    }
+
+    // Bursts of an RN16 reply, work calls of 4096 samples
+    const int CHUNK = 4096;
+    float n_samples_TAG_BIT = TAG_BIT_D * S_RATE / 1e6;
+    int burst = (RN16_BITS + TAG_PREAMBLE_BITS) * n_samples_TAG_BIT + 2*n_samples_TAG_BIT;
+
+    printf("%-28s %10s %10s %10s %10s\n", "stage", "samples", "commands", "ns/sample", "MS/s");
+    for (int volk = 0; volk < 2; volk++)
+    {
+      burst_gate gate(WIN_SIZE_D * S_RATE / 1e6, DC_SIZE_D * S_RATE / 1e6,
+                      T1_D * S_RATE / 1e6, PW_D * S_RATE / 1e6, volk);
+      std::vector<gr_complex> reply(burst);
+      std::vector<float> magn_squared(burst);
+      int n_commands = 0;
+      double ns = time_ns(1, [&]() {
+        gate.expect(burst);
+        for (int start = 0; start < in.size(); start += CHUNK)
+        {
+          int end = std::min((int) in.size(), start + CHUNK);
+          for (int i = start; i < end; )
+          {
+            int n_out;
+            i += gate.process(&in[i], end - i, &reply[gate.is_open() ? gate.burst_size() : 0], &magn_squared[0], n_out);
+            if (gate.opened())
+              n_commands++;
+            if (gate.closed())
+              gate.expect(burst);
+          }
+        }
+      });
+      const char * name = volk ? "gate volk" : "gate scalar";
+      printf("%-28s %10d %10d %10.2f %10.1f\n", name, (int) in.size(), n_commands, ns / in.size(), in.size() * 1e3 / ns);
+      add_record("gate", name, {{"samples", (double) in.size()}, {"commands", (double) n_commands},
+                                {"ns_per_sample", ns / in.size()}, {"ms_per_s", in.size() * 1e3 / ns}});
+    }
+
+    // Matched filter, gate and decoder from ADC samples
+    replay_engine engine(ADC_RATE, DECIM);
+    double ns = time_ns(1, [&]() {
+      for (int i = 0; i < adc.size(); i += CHUNK * DECIM)
+        engine.process(&adc[i], std::min(CHUNK * DECIM, (int) adc.size() - i));
+    });
+    printf("%-28s %10d %10ld %10.2f %10.1f\n", "receive chain (adc)", (int) adc.size(), engine.stats().n_commands,
+           ns / adc.size(), adc.size() * 1e3 / ns);
+    add_record("gate", "receive chain (adc)", {{"samples", (double) adc.size()}, {"commands", (double) engine.stats().n_commands},
+                                               {"ns_per_sample", ns / adc.size()}, {"ms_per_s", adc.size() * 1e3 / ns},
+                                               {"x_real_time", adc.size() * 1e9 / ns / ADC_RATE}});
+  }
+
+} // namespace
+
+void usage()
+{
+  fprintf(stderr, "usage: bench-rfid [-j results.json] [decoder | crc | sync | gate | waveform | loop [n_tags] | all | <capture>]\n");
+}
+
+int main(int argc, char ** argv)
+{
+  float n_samples_TAG_BIT = TAG_BIT_D * S_RATE / pow(10,6);
+  int n_samples_EPC = (EPC_BITS + TAG_PREAMBLE_BITS) * n_samples_TAG_BIT + 2*n_samples_TAG_BIT;
+
+  const char * json = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:")) != -1)
+  {
+    if (opt != 'j')
+    {
+      usage();
+      return 1;
+    }
+    json = optarg;
+  }
+
+  std::string suite = optind < argc ? argv[optind] : "decoder";
+  bool all = suite == "all";
+  bool known = all;
+
+  if (all || suite == "decoder")
+  {
+    bench_synthetic(n_samples_TAG_BIT, n_samples_EPC);
+    known = true;
+  }
+  if (all || suite == "crc")
+  {
+    bench_crc();
+    known = true;
+  }
+  if (all || suite == "sync")
+  {
+    bench_sync(n_samples_TAG_BIT, n_samples_EPC);
+    known = true;
+  }
+  if (all || suite == "gate")
+  {
+    bench_gate();
+    known = true;
+  }
+  if (all || suite == "waveform")
+  {
+    bench_waveform();
+    known = true;
+  }
+  if (all || suite == "loop")
+  {
+    bench_loop(optind + 1 < argc ? atoi(argv[optind + 1]) : 100);
+    known = true;
+  }
+  if (!known && bench_capture(argv[optind], n_samples_TAG_BIT, n_samples_EPC) != 0)
+    return 1;
+
+  if (json && !write_json(json))
+    return 1;
+  return 0;
+}
@@ -1,17 +1,17 @@
 /* -*- c++ -*- */
-/* 
+/*
  * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
- * 
+ *
  * This is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 3, or (at your option)
  * any later version.
- * 
+ *
  * This software is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
- * 
+ *
  * You should have received a copy of the GNU General Public License
  * along with this software; see the file COPYING.  If not, write to
  * the Free Software Foundation, Inc., 51 Franklin Street,
@@ -22,36 +22,38 @@
 #include "config.h"
 #endif
 
-#include <gnuradio/io_signature.h>
-#include "rfid/global_vars.h"
+#include "boxcar_filter.h"
 
-#include <iostream>
 namespace gr {
   namespace rfid {
-    
-    READER_STATE * reader_state;
 
-    void initialize_reader_state()
-    {
-      reader_state = new READER_STATE;
-      reader_state-> reader_stats.n_queries_sent = 0;
-      reader_state-> reader_stats.n_epc_correct = 0;
-
-      std::vector<int>  unique_tags_round;
-       std::map<int,int> tag_reads;    
-
-      reader_state-> status           = RUNNING;
-      reader_state-> gen2_logic_status= START;
-      reader_state-> gate_status       = GATE_SEEK_RN16;
-      reader_state-> decoder_status   = DECODER_DECODE_RN16;
-
-      reader_state-> reader_stats.max_slot_number = pow(2,FIXED_Q);
+    const int boxcar_filter::RESYNC;
 
-      reader_state-> reader_stats.cur_inventory_round = 1;
-      reader_state-> reader_stats.cur_slot_number     = 1;
+    boxcar_filter::boxcar_filter(int n_taps, int decim)
+      : d_taps(n_taps), d_decim(decim)
+    {
+    }
 
-      gettimeofday (&reader_state-> reader_stats.start, NULL);
+    void boxcar_filter::filter(const gr_complex * in, int n_out, gr_complex * out) const
+    {
+      for (int k = 0; k < n_out; k++)
+      {
+        const gr_complex * x = &in[k * d_decim];
+        gr_complex sum(0,0);
+        if (d_taps <= d_decim || k % RESYNC == 0)
+        {
+          for (int j = 0; j < d_taps; j++)
+            sum += x[j];
+        }
+        else
+        {
+          // Slide the previous window by decim samples
+          sum = out[k - 1];
+          for (int j = 0; j < d_decim; j++)
+            sum += x[d_taps - d_decim + j] - x[j - d_decim];
+        }
+        out[k] = sum;
+      }
     }
   } /* namespace rfid */
 } /* namespace gr */
-
@@ -0,0 +1,60 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_BOXCAR_FILTER_H
+#define INCLUDED_RFID_BOXCAR_FILTER_H
+
+#include <rfid/api.h>
+#include <gnuradio/gr_complex.h>
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Matched filter of the receive chain: all-ones FIR with decimation.
+     *
+     * A window no longer than the decimation is summed once per output
+     * (integrate and dump). A longer window slides as a running sum, one
+     * add and one subtract per input sample instead of n_taps complex MACs
+     * per output; the sum is restarted every RESYNC outputs so that
+     * rounding errors do not build up.
+     */
+    class RFID_API boxcar_filter
+    {
+      public:
+        static const int RESYNC = 256;
+
+        boxcar_filter(int n_taps, int decim);
+
+        void set_taps(int n_taps) { d_taps = n_taps; }
+        int taps() const { return d_taps; }
+        int decimation() const { return d_decim; }
+
+        // out[k] = in[k * decim] + ... + in[k * decim + n_taps - 1], for k < n_out
+        void filter(const gr_complex * in, int n_out, gr_complex * out) const;
+
+      private:
+        int d_taps, d_decim;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_BOXCAR_FILTER_H */
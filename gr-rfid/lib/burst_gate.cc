@@ -0,0 +1,90 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <volk/volk.h>
+#include "burst_gate.h"
+
+namespace gr {
+  namespace rfid {
+
+    burst_gate::burst_gate(int win_length, int dc_length, int n_samples_T1, int n_samples_PW, bool use_volk)
+      : d_tracker(win_length, dc_length, n_samples_T1, n_samples_PW, use_volk),
+        open(false), d_opened(false), d_closed(false), n_samples(0), n_to_ungate(0)
+    {
+    }
+
+    void burst_gate::expect(int n_samples)
+    {
+      open = false;
+      n_to_ungate = n_samples;
+      d_tracker.reset_count(0);
+    }
+
+    void burst_gate::reset()
+    {
+      d_tracker.reset();
+      open = d_opened = d_closed = false;
+      n_samples = 0;
+    }
+
+    int burst_gate::process(const gr_complex * in, int n_items, gr_complex * out, float * magn_squared, int & n_out)
+    {
+      d_opened = d_closed = false;
+      n_out = 0;
+      if (!open)
+      {
+        // Track amplitude/DC offset until the end of a reader command
+        int i = d_tracker.seek_command(in, n_items);
+        if (d_tracker.command_detected())
+        {
+          open = d_opened = true;
+          out[0] = in[i - 1] - d_tracker.dc_offset();
+          magn_squared[0] = std::norm(out[0]);
+          n_samples = n_out = 1;
+        }
+        return i;
+      }
+
+      // Forward the tag reply, without DC offset
+      int n = std::max(0, std::min(n_items, n_to_ungate - n_samples));
+      gr_complex dc_est = d_tracker.dc_offset();
+      d_tracker.track_amplitude(in, n);
+      for (int j = 0; j < n; j++)
+        out[j] = in[j] - dc_est;
+      volk_32fc_magnitude_squared_32f(&magn_squared[n_samples], out, n);
+      n_samples += n;
+      n_out = n;
+
+      if (n_samples >= n_to_ungate)
+      {
+        open = false;
+        d_closed = true;
+        d_tracker.reset_count(n_samples);
+      }
+      return n;
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,75 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_BURST_GATE_H
+#define INCLUDED_RFID_BURST_GATE_H
+
+#include <rfid/api.h>
+#include <gnuradio/gr_complex.h>
+#include "gate_tracker.h"
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Cuts the tag reply that follows each reader command.
+     *
+     * Closed, the gate tracks amplitude and DC offset until the end of a
+     * reader command. It then opens and forwards the burst length set by
+     * expect(), DC offset removed, starting with the sample that detected
+     * the command, and closes again. Shared by gate_impl and the open-loop
+     * replay_engine, which only differ in what they do at the edges.
+     */
+    class RFID_API burst_gate
+    {
+      public:
+        burst_gate(int win_length, int dc_length, int n_samples_T1, int n_samples_PW, bool use_volk = true);
+
+        gate_tracker & tracker() { return d_tracker; }
+
+        // Closes the gate; the next burst is n_samples long, counted from the next reader command
+        void expect(int n_samples);
+
+        /*!
+         * Runs the gate over in until it opens, closes or the input ends and
+         * returns the number of samples of in processed. Reply samples go to
+         * out (n_out of them), their squared magnitude to magn_squared at
+         * their offset in the burst.
+         */
+        int process(const gr_complex * in, int n_items, gr_complex * out, float * magn_squared, int & n_out);
+
+        bool is_open() const { return open; }
+        bool opened() const { return d_opened; }      // by the last process()
+        bool closed() const { return d_closed; }      // by the last process(), burst complete
+        int burst_size() const { return n_samples; }
+
+        // Closed, empty tracker windows
+        void reset();
+
+      private:
+        gate_tracker d_tracker;
+        bool open, d_opened, d_closed;
+        int n_samples, n_to_ungate;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_BURST_GATE_H */
@@ -0,0 +1,179 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "crc.h"
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+
+      constexpr crc16_tables make_crc16_tables()
+      {
+        crc16_tables r{};
+        for (int b = 0; b < 256; b++)
+        {
+          uint16_t c = b << 8;
+          for (int i = 0; i < 8; i++)
+            c = (c & 0x8000) ? (uint16_t) ((c << 1) ^ crc16::POLY) : (uint16_t) (c << 1);
+          r.t[0][b] = c;
+        }
+        for (int k = 1; k < 8; k++)
+          for (int b = 0; b < 256; b++)
+            r.t[k][b] = (uint16_t) (r.t[k-1][b] << 8) ^ r.t[0][r.t[k-1][b] >> 8];
+        return r;
+      }
+
+      constexpr crc5_table make_crc5_table()
+      {
+        crc5_table r{};
+        for (int b = 0; b < 256; b++)
+        {
+          uint8_t c = b;
+          for (int i = 0; i < 8; i++)
+            c = (c & 0x80) ? (uint8_t) ((c << 1) ^ (crc5::POLY << 3)) : (uint8_t) (c << 1);
+          r.t[b] = c;
+        }
+        return r;
+      }
+
+      constexpr uint8_t crc5_step(uint8_t crc, int bit)
+      {
+        return ((crc >> 4) ^ bit) ? (uint8_t) (((crc << 1) & 0x1f) ^ crc5::POLY) : (uint8_t) ((crc << 1) & 0x1f);
+      }
+
+      // Register after the Query code (1000b), then one payload bit per level:
+      // entry i of level L+1 extends entry i >> 1 of level L by bit i & 1
+      constexpr crc5_query_table make_crc5_query_table()
+      {
+        crc5_query_table r{};
+        r.t[0] = crc5_step(crc5_step(crc5_step(crc5_step(crc5::PRESET, 1), 0), 0), 0);
+        for (int n = 1; n < (1 << 13); n <<= 1)
+          for (int i = n - 1; i >= 0; i--)
+          {
+            uint8_t c = r.t[i];
+            r.t[2*i + 1] = crc5_step(c, 1);
+            r.t[2*i] = crc5_step(c, 0);
+          }
+        return r;
+      }
+
+      static_assert(make_crc16_tables().t[0][1] == crc16::POLY, "CRC-16 table");
+      static_assert(make_crc5_table().t[1] == (crc5::POLY << 3), "CRC-5 table");
+      static_assert(make_crc5_query_table().t[0] == 0x10, "CRC-5 Query table");
+
+      // Bits [pos, pos + n) of a packed word stream, left-aligned (n <= 64)
+      inline uint64_t window(const uint64_t * words, int pos, int n)
+      {
+        int offset = pos & 63;
+        uint64_t v = words[pos >> 6] << offset;
+        if (offset && offset + n > 64)
+          v |= words[(pos >> 6) + 1] >> (64 - offset);
+        return v;
+      }
+
+      inline uint16_t slice8(const crc16_tables & tables, uint16_t crc, uint64_t v)
+      {
+        const uint16_t (*t)[256] = tables.t;
+        return t[7][(crc >> 8) ^ (v >> 56)] ^ t[6][(crc & 0xff) ^ ((v >> 48) & 0xff)] ^
+               t[5][(v >> 40) & 0xff] ^ t[4][(v >> 32) & 0xff] ^
+               t[3][(v >> 24) & 0xff] ^ t[2][(v >> 16) & 0xff] ^
+               t[1][(v >> 8) & 0xff]  ^ t[0][v & 0xff];
+      }
+    }
+
+    const crc16_tables crc16::tables = make_crc16_tables();
+    const crc5_table crc5::table = make_crc5_table();
+    const crc5_query_table crc5::query_table = make_crc5_query_table();
+
+    uint16_t crc16::update(uint16_t crc, const uint8_t * data, size_t n_bytes)
+    {
+      const uint16_t (*t)[256] = tables.t;
+
+      // Slicing-by-8
+      while (n_bytes >= 8)
+      {
+        crc = t[7][(crc >> 8) ^ data[0]] ^ t[6][(crc & 0xff) ^ data[1]] ^
+              t[5][data[2]] ^ t[4][data[3]] ^ t[3][data[4]] ^ t[2][data[5]] ^
+              t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        n_bytes -= 8;
+      }
+      // Slicing-by-4
+      if (n_bytes >= 4)
+      {
+        crc = t[3][(crc >> 8) ^ data[0]] ^ t[2][(crc & 0xff) ^ data[1]] ^ t[1][data[2]] ^ t[0][data[3]];
+        data += 4;
+        n_bytes -= 4;
+      }
+      while (n_bytes--)
+        crc = (uint16_t) (crc << 8) ^ t[0][(crc >> 8) ^ *data++];
+      return crc;
+    }
+
+    uint16_t crc16::update_bits(uint16_t crc, const uint64_t * words, int first, int n_bits)
+    {
+      int pos = first, end = first + n_bits;
+      for (; end - pos >= 64; pos += 64)
+        crc = slice8(tables, crc, window(words, pos, 64));
+      for (; end - pos >= 8; pos += 8)
+        crc = (uint16_t) (crc << 8) ^ tables.t[0][(crc >> 8) ^ (window(words, pos, 8) >> 56)];
+      for (; pos < end; pos++)
+        crc = update_bit(crc, window(words, pos, 1) >> 63);
+      return crc;
+    }
+
+    bool crc16::check(const uint64_t * words, int n_bits)
+    {
+      uint16_t crc = update_bits(PRESET, words, 0, n_bits - 16);
+      uint16_t rcvd_crc = window(words, n_bits - 16, 16) >> 48;
+      return (uint16_t) ~crc == rcvd_crc;
+    }
+
+    uint8_t crc5::update_bits(uint8_t crc, const uint64_t * words, int first, int n_bits)
+    {
+      int pos = first, end = first + n_bits;
+      uint8_t reg = crc << 3;
+      for (; end - pos >= 8; pos += 8)
+        reg = table.t[reg ^ (window(words, pos, 8) >> 56)];
+      crc = reg >> 3;
+      for (; pos < end; pos++)
+        crc = update_bit(crc, window(words, pos, 1) >> 63);
+      return crc;
+    }
+
+    uint8_t crc5::compute(uint64_t value, int n_bits)
+    {
+      // Leading bits one at a time, then whole bytes
+      uint8_t crc = PRESET;
+      int n = n_bits;
+      for (; n % 8; n--)
+        crc = update_bit(crc, (value >> (n - 1)) & 1);
+      uint8_t reg = crc << 3;
+      for (; n > 0; n -= 8)
+        reg = table.t[reg ^ ((value >> (n - 8)) & 0xff)];
+      return reg >> 3;
+    }
+  } /* namespace rfid */
+} /* namespace gr */
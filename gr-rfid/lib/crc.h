@@ -0,0 +1,122 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_CRC_H
+#define INCLUDED_RFID_CRC_H
+
+#include <rfid/api.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gr {
+  namespace rfid {
+
+    // Lookup tables, generated at compile time
+    struct crc16_tables { uint16_t t[8][256]; };  // t[k][b]: byte b followed by k zero bytes
+    struct crc5_table { uint8_t t[256]; };        // register kept in the 5 MSBs of a byte
+    struct crc5_query_table { uint8_t t[1 << 13]; };  // CRC-5 per Query payload
+
+    /*!
+     * \brief CRC-16 of Gen2 (EPC memory, Select): x^16 + x^12 + x^5 + 1, preset 0xFFFF, inverted.
+     *
+     * update() advances the register without the final inversion, so that a
+     * message can be processed in pieces. Bytes are processed 8 (then 4) at a
+     * time with slicing tables; the bit-stream entries accept inputs of any
+     * length and alignment.
+     */
+    class RFID_API crc16
+    {
+      public:
+        static const uint16_t PRESET = 0xFFFF;
+        static const uint16_t POLY = 0x1021;
+
+        static const crc16_tables tables;
+
+        // Bytes, first byte first
+        static uint16_t update(uint16_t crc, const uint8_t * data, size_t n_bytes);
+
+        // Bits [first, first + n_bits) of a packed MSB-first word stream
+        static uint16_t update_bits(uint16_t crc, const uint64_t * words, int first, int n_bits);
+
+        // Bits one per element (non-zero is 1)
+        template <typename T>
+        static uint16_t update_bits(uint16_t crc, const T * bits, int n_bits)
+        {
+          for (int i = 0; i < n_bits; i++)
+            crc = update_bit(crc, bits[i] != 0);
+          return crc;
+        }
+
+        static uint16_t update_bit(uint16_t crc, bool bit)
+        {
+          bool msb = (crc >> 15) ^ bit;
+          crc <<= 1;
+          return msb ? crc ^ POLY : crc;
+        }
+
+        static uint16_t compute(const uint8_t * data, size_t n_bytes) { return ~update(PRESET, data, n_bytes); }
+
+        // True if the last 16 of n_bits packed bits are the CRC-16 of the preceding bits
+        static bool check(const uint64_t * words, int n_bits);
+    };
+
+    /*!
+     * \brief CRC-5 of the Gen2 Query: x^5 + x^3 + 1, preset 01001b, not inverted.
+     */
+    class RFID_API crc5
+    {
+      public:
+        static const uint8_t PRESET = 0x09;
+        static const uint8_t POLY = 0x09;
+
+        static const crc5_table table;
+        static const crc5_query_table query_table;
+
+        // Bits [first, first + n_bits) of a packed MSB-first word stream
+        static uint8_t update_bits(uint8_t crc, const uint64_t * words, int first, int n_bits);
+
+        // Bits one per element (non-zero is 1)
+        template <typename T>
+        static uint8_t update_bits(uint8_t crc, const T * bits, int n_bits)
+        {
+          for (int i = 0; i < n_bits; i++)
+            crc = update_bit(crc, bits[i] != 0);
+          return crc;
+        }
+
+        static uint8_t update_bit(uint8_t crc, bool bit)
+        {
+          bool msb = (crc >> 4) ^ bit;
+          crc = (crc << 1) & 0x1f;
+          return msb ? crc ^ POLY : crc;
+        }
+
+        // CRC-5 of the n_bits (<= 64) LSBs of value, MSB first
+        static uint8_t compute(uint64_t value, int n_bits);
+
+        // CRC-5 of a Query with the 13 bits between command code and CRC
+        // (DR, M, TRext, Sel, Session, Target, Q) given as payload
+        static uint8_t query(uint32_t payload) { return query_table.t[payload & 0x1fff]; }
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_CRC_H */
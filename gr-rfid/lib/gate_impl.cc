@@ -24,37 +24,37 @@
 
 #include <gnuradio/io_signature.h>
 #include "gate_impl.h"
+#include "reply_decoder.h"
 #include <sys/time.h>
+#include <algorithm>
+#include <cmath>
 
 namespace gr {
   namespace rfid {
 
     gate::sptr
-    gate::make(int sample_rate)
+    gate::make(session::sptr reader_session, int sample_rate, int decim)
     {
       return gnuradio::get_initial_sptr
-        (new gate_impl(sample_rate));
+        (new gate_impl(reader_session, sample_rate, decim));
     }
     /*
      * The private constructor
      */
-    gate_impl::gate_impl(int sample_rate)
+    gate_impl::gate_impl(session::sptr reader_session, int sample_rate, int decim)
       : gr::block("gate",
               gr::io_signature::make(1, 1, sizeof(gr_complex)),
               gr::io_signature::make(1, 1, sizeof(gr_complex))),
-              n_samples(0), win_index(0), dc_index(0), num_pulses(0), signal_state(NEG_EDGE), avg_ampl(0), dc_est(0,0)
+              n_samples_T1(T1_D * (sample_rate / pow(10,6))),
+              n_samples_PW(PW_D * (sample_rate / pow(10,6))),
+              n_samples_TAG_BIT(TAG_BIT_D * (sample_rate / pow(10,6))),
+              win_length(WIN_SIZE_D * (sample_rate/ pow(10,6))),
+              dc_length(DC_SIZE_D  * (sample_rate / pow(10,6))), s_rate(sample_rate),
+              decim(decim), max_taps(std::ceil(float(sample_rate) * decim / BLF_MIN / 2)), matched_filter(1, std::max(1, decim)),
+              gate(win_length, dc_length, n_samples_T1, n_samples_PW),
+              reader_session(reader_session), reader_state(reader_session->state()),
+              latency(reader_session->latency()), board(reader_session->board())
     {
-
-       n_samples_T1       = T1_D       * (sample_rate / pow(10,6));
-       n_samples_PW       = PW_D       * (sample_rate / pow(10,6));
-        n_samples_TAG_BIT = TAG_BIT_D * (sample_rate / pow(10,6));
-      
-      win_length = WIN_SIZE_D * (sample_rate/ pow(10,6));
-      dc_length  = DC_SIZE_D  * (sample_rate / pow(10,6));
-
-      win_samples.resize(win_length);
-      dc_samples.resize(dc_length);
-
       GR_LOG_INFO(d_logger, "T1 samples : " << n_samples_T1);
       GR_LOG_INFO(d_logger, "PW samples : " << n_samples_PW);
 
@@ -63,10 +63,21 @@ namespace gr {
       GR_LOG_INFO(d_logger, "Size of window for dc offset estimation : " << dc_length);
       GR_LOG_INFO(d_logger, "Duration of window for dc offset estimation : " << DC_SIZE_D << " us");
 
-      
-      // First block to be scheduled
-      GR_LOG_INFO(d_logger, "Initializing reader state...");
-      initialize_reader_state();
+      // Window of the longest matched filter (lowest BLF) before the first ADC sample of a call
+      if (decim > 0)
+      {
+        set_history(max_taps);
+        GR_LOG_INFO(d_logger, "Matched filter on ADC samples, decimation : " << decim);
+      }
+      set_link(link_timing(), TAG_ENCODING);
+
+      // Squared magnitudes of a whole EPC reply, written in place while the gate is open; Miller-8 at the lowest BLF is the longest
+      int n_samples_longest = reply_decoder::burst_samples(EPC_BITS, 8, sample_rate / BLF_MIN);
+      if (reader_state->magn_squared_samples.size() < n_samples_longest)
+        reader_state->magn_squared_samples.resize(n_samples_longest);
+
+      // Output samples are only tag replies, delimited by burst_start/burst_end tags
+      set_tag_propagation_policy(TPP_DONT);
     } 
 
     /*
@@ -76,10 +87,27 @@ namespace gr {
     {
     }
 
+    void gate_impl::set_link(const link_timing & link, int m)
+    {
+      // T1 and DC window follow BLF and RTcal, pulse detection the Tari, the reply lengths also the tag encoding
+      this->link = link;
+      cycles_per_symbol = m;
+      n_samples_TAG_BIT = s_rate / link.blf;
+      n_samples_T1 = round(link.t1_d * s_rate / 1e6);
+      n_samples_PW = round(link.pw_d * s_rate / 1e6);
+      dc_length = round(link.dc_d * s_rate / 1e6);
+      gate.tracker().set_timing(dc_length, n_samples_T1, n_samples_PW);
+      // Boxcar over half a tag bit, as fir_filter_ccc(decim, [1] * taps) in front of the gate
+      matched_filter.set_taps(std::max(1, int(s_rate * std::max(1, decim) / link.blf / 2)));
+
+      n_samples_RN16 = reply_decoder::burst_samples(RN16_BITS, m, n_samples_TAG_BIT);
+      n_samples_EPC  = reply_decoder::burst_samples(EPC_BITS, m, n_samples_TAG_BIT);
+    }
+
     void
     gate_impl::forecast (int noutput_items, gr_vector_int &ninput_items_required)
     {
-        ninput_items_required[0] = noutput_items;
+        ninput_items_required[0] = noutput_items * std::max(1, decim);
     }
 
     int
@@ -93,13 +121,16 @@ namespace gr {
       gr_complex *out = (gr_complex *) output_items[0];
 
       int n_items = ninput_items[0];
+      int step = std::max(1, decim);   // gate input samples per sample of in
+      if (decim > 0)
+        n_items = std::min(n_items / decim, noutput_items);
       int number_samples_consumed = n_items;
-      float sample_ampl = 0;
       int written = 0;
+      float * magn_squared = &reader_state->magn_squared_samples[0];
 
       
       if( (reader_state-> reader_stats.n_queries_sent   > MAX_NUM_QUERIES ||
-           reader_state-> reader_stats.tag_reads.size() > NUMBER_UNIQUE_TAGS) &&  
+           board->snapshot().n_unique_tags > NUMBER_UNIQUE_TAGS) &&  
            reader_state-> status != TERMINATED)
       {
         reader_state-> status = TERMINATED;
@@ -108,94 +139,66 @@ namespace gr {
         GR_LOG_INFO(d_logger, "Termination");
        }
 
-      // Gate block is controlled by the Gen2 Logic block
+      // Gate block is controlled by the Gen2 Logic block, which sets the link and tag encoding before GATE_SEEK_RN16
+      if (reader_state->blf != link.blf || reader_state->tari != link.tari_d || reader_state->data1 != link.data1 ||
+          reader_state->cycles_per_symbol != cycles_per_symbol)
+        set_link(link_timing(reader_state->blf, DR, reader_state->tari, reader_state->data1), reader_state->cycles_per_symbol);
       if(reader_state->gate_status == GATE_SEEK_EPC)
       {
         reader_state->gate_status = GATE_CLOSED;
-        reader_state->n_samples_to_ungate = (EPC_BITS + TAG_PREAMBLE_BITS) * n_samples_TAG_BIT + 2*n_samples_TAG_BIT;
-        n_samples = 0;
+        reader_state->n_samples_to_ungate = n_samples_EPC;
+        gate.expect(n_samples_EPC);
       }
       else if (reader_state->gate_status == GATE_SEEK_RN16)
       {
         reader_state->gate_status = GATE_CLOSED;
-        reader_state->n_samples_to_ungate = (RN16_BITS + TAG_PREAMBLE_BITS) * n_samples_TAG_BIT + 2*n_samples_TAG_BIT;
-        n_samples = 0;
+        reader_state->n_samples_to_ungate = n_samples_RN16;
+        gate.expect(n_samples_RN16);
+      }
+
+      if (decim > 0 && reader_state->status == RUNNING)
+      {
+        // Matched filter and decimation in one pass over the ADC samples, with the taps of the
+        // current BLF; the window of filtered sample k ends at ADC sample k * decim of this call
+        if (filtered.size() < n_items)
+          filtered.resize(n_items);
+        matched_filter.filter(&in[max_taps - matched_filter.taps()], n_items, &filtered[0]);
+        in = &filtered[0];
       }
       
       if (reader_state->status == RUNNING)
       {
-        for(int i = 0; i < n_items; i++)
+        int i = 0;
+        while (i < n_items)
         {
-          // Tracking average amplitude
-          sample_ampl = std::abs(in[i]);
-          avg_ampl = avg_ampl + (sample_ampl - win_samples[win_index])/win_length;  
-          win_samples[win_index] = sample_ampl; 
-          win_index = (win_index + 1) % win_length;
-  
-          //Threshold for detecting negative/positive edges
-          sample_thresh = avg_ampl * THRESH_FRACTION;  
-
-          if( !(reader_state->gate_status == GATE_OPEN) )
+          // Reply samples without DC offset go to the output, their magnitudes to the session buffer
+          int n_out;
+          i += gate.process(&in[i], n_items - i, &out[written], magn_squared, n_out);
+
+          if (gate.opened())
           {
-            //Tracking DC offset (only during T1)
-            dc_est =  dc_est + (in[i] - dc_samples[dc_index])/std::complex<float>(dc_length,0);  
-            dc_samples[dc_index] = in[i]; 
-            dc_index = (dc_index + 1) % dc_length;
-          
-            n_samples++;
-
-            // Potitive edge -> Negative edge
-            if( sample_ampl < sample_thresh && signal_state == POS_EDGE)
-            {
-              n_samples = 0;
-              signal_state = NEG_EDGE;
-            }
-            // Negative edge -> Positive edge 
-            else if (sample_ampl > sample_thresh && signal_state == NEG_EDGE)
-            {
-              signal_state = POS_EDGE;
-              if (n_samples > n_samples_PW/2)
-                num_pulses++; 
-              else
-                num_pulses = 0; 
-              n_samples = 0;
-            }
-
-            if(n_samples > n_samples_T1 && signal_state == POS_EDGE && num_pulses > NUM_PULSES_COMMAND)
-            {
-              GR_LOG_INFO(d_debug_logger, "READER COMMAND DETECTED");
-
-              reader_state->gate_status = GATE_OPEN;
-
-              reader_state->magn_squared_samples.resize(0);
-
-
-              reader_state->magn_squared_samples.push_back(std::norm(in[i] - dc_est));
-              out[written] = in[i] - dc_est;  
-              written++;
-
-              num_pulses = 0; 
-              n_samples =  1; // Count number of samples passed to the next block
-
-            }
+            GR_LOG_INFO(d_debug_logger, "READER COMMAND DETECTED");
+
+            reader_state->gate_status = GATE_OPEN;
+            reader_state->burst_noise = gate.tracker().dc_noise();
+            latency->stamp(STAGE_GATE_OPEN);
+
+            // Mark the first sample of the tag reply with its offset in the gate input
+            add_item_tag(0, nitems_written(0) + written, pmt::mp("burst_start"), pmt::from_uint64(nitems_read(0) + (i - 1) * step));
           }
-          else
+          written += n_out;
+
+          if (gate.closed())
           {
-            n_samples++;
-
-            reader_state->magn_squared_samples.push_back(std::norm(in[i] - dc_est));
-            out[written] = in[i] - dc_est; // Remove offset from complex samples           
-            written++;
-            if (n_samples >= reader_state->n_samples_to_ungate)
-            {
-              reader_state->gate_status = GATE_CLOSED;    
-              number_samples_consumed = i+1;
-              break;
-            }
+            reader_state->gate_status = GATE_CLOSED;
+            latency->stamp(STAGE_GATE_CLOSE);
+            add_item_tag(0, nitems_written(0) + written - 1, pmt::mp("burst_end"), pmt::from_uint64(nitems_read(0) + (i - 1) * step));
+            number_samples_consumed = i;
+            break;
           }
         }
       }
-      consume_each (number_samples_consumed);
+      consume_each (number_samples_consumed * step);
       return written;
     }
   } /* namespace rfid */
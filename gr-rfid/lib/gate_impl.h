@@ -24,6 +24,11 @@
 #include <rfid/gate.h>
 #include <vector>
 #include "rfid/global_vars.h"
+#include "boxcar_filter.h"
+#include "burst_gate.h"
+#include "link_timing.h"
+#include "latency_monitor.h"
+#include "stats_board.h"
 
 namespace gr { 
   namespace rfid {
@@ -31,20 +36,27 @@ namespace gr {
     {
       private:
   
-        enum SIGNAL_STATE {NEG_EDGE, POS_EDGE};
+        int   n_samples_T1, n_samples_PW;
+        float n_samples_TAG_BIT;
+        int  n_samples_RN16, n_samples_EPC; // Samples to ungate
+        link_timing link;                   // link they are computed for (BLF, Tari)
+        int  cycles_per_symbol;             // and tag encoding
+        int  win_length, dc_length, s_rate;
 
-        int   n_samples, n_samples_T1, n_samples_PW, n_samples_TAG_BIT; 
-        int  win_index, dc_index, win_length, dc_length, s_rate;
-        float avg_ampl, num_pulses, sample_thresh;
+        int  decim, max_taps;               // matched filter on ADC samples if decim > 0
+        boxcar_filter matched_filter;
+        std::vector<gr_complex> filtered;
+        burst_gate gate;
 
-        std::vector<float> win_samples,cw_samples;  
-        std::vector<gr_complex> dc_samples;
-        gr_complex dc_est;
+        session::sptr reader_session;
+        READER_STATE * reader_state;
+        latency_monitor * latency;
+        stats_board * board;
 
-        SIGNAL_STATE signal_state;
+        void set_link(const link_timing & link, int m);
 
        public:
-        gate_impl(int sample_rate);
+        gate_impl(session::sptr reader_session, int sample_rate, int decim);
         ~gate_impl();
 
         void forecast (int noutput_items, gr_vector_int &ninput_items_required);
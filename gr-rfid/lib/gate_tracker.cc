@@ -0,0 +1,343 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <algorithm>
+#include <string.h>
+#include <volk/volk.h>
+#include "gate_tracker.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    // Samples processed per VOLK call
+    const int BLOCK_SIZE = 4096;
+
+    // Copy n samples into a circular buffer of size len, starting at index
+    template <typename T>
+    static void write_ring(std::vector<T> & ring, int index, const T * src, int n)
+    {
+      int len = ring.size();
+      if (n > len)
+      {
+        // Only the last len samples stay in the buffer
+        index = (index + n - len) % len;
+        src += n - len;
+        n = len;
+      }
+      int first = std::min(n, len - index);
+      memcpy(&ring[index], src, sizeof(T) * first);
+      memcpy(&ring[0], src + first, sizeof(T) * (n - first));
+    }
+
+    // Oldest n samples of a circular buffer of size len, starting at index
+    template <typename T>
+    static void read_ring(const std::vector<T> & ring, int index, T * dst, int n)
+    {
+      int len = ring.size();
+      int first = std::min(n, len - index);
+      memcpy(dst, &ring[index], sizeof(T) * first);
+      memcpy(dst + first, &ring[0], sizeof(T) * (n - first));
+    }
+
+    gate_tracker::gate_tracker(int win_length, int dc_length, int n_samples_T1, int n_samples_PW, bool use_volk)
+      : n_samples(0), n_samples_T1(n_samples_T1), n_samples_PW(n_samples_PW),
+        win_index(0), dc_index(0), win_length(win_length), dc_length(dc_length),
+        avg_ampl(0), num_pulses(0), use_volk(use_volk), detected(false),
+        dc_est(0,0), signal_state(NEG_EDGE)
+    {
+      inv_win_length = 1.0f / win_length;
+      inv_dc_length  = 1.0f / dc_length;
+
+      win_samples.resize(win_length);
+      dc_samples.resize(dc_length);
+
+      magn.resize(BLOCK_SIZE);
+      old_magn.resize(BLOCK_SIZE);
+      avg.resize(BLOCK_SIZE);
+      thresh.resize(BLOCK_SIZE);
+      dc_delta.resize(BLOCK_SIZE);
+      old_dc.resize(BLOCK_SIZE);
+      below.resize(BLOCK_SIZE);
+      above.resize(BLOCK_SIZE);
+    }
+
+    void gate_tracker::reset()
+    {
+      n_samples = 0;
+      win_index = dc_index = 0;
+      avg_ampl = 0;
+      num_pulses = 0;
+      detected = false;
+      dc_est = gr_complex(0,0);
+      signal_state = NEG_EDGE;
+      win_samples.assign(win_length, 0);
+      dc_samples.assign(dc_length, gr_complex(0,0));
+    }
+
+    void gate_tracker::set_timing(int dc_length, int n_samples_T1, int n_samples_PW)
+    {
+      this->n_samples_T1 = n_samples_T1;
+      this->n_samples_PW = n_samples_PW;
+      if (dc_length == this->dc_length)
+        return;
+      this->dc_length = dc_length;
+      inv_dc_length = 1.0f / dc_length;
+      dc_samples.assign(dc_length, gr_complex(0,0));
+      dc_index = 0;
+      dc_est = gr_complex(0,0);
+    }
+
+    int gate_tracker::seek_command(const gr_complex * in, int n_items)
+    {
+      if (use_volk)
+        return seek_command_volk(in, n_items);
+      else
+        return seek_command_scalar(in, n_items);
+    }
+
+    void gate_tracker::track_amplitude(const gr_complex * in, int n_items)
+    {
+      if (use_volk)
+        track_amplitude_volk(in, n_items);
+      else
+        track_amplitude_scalar(in, n_items);
+    }
+
+    int gate_tracker::seek_command_scalar(const gr_complex * in, int n_items)
+    {
+      detected = false;
+
+      for(int i = 0; i < n_items; i++)
+      {
+        // Tracking average amplitude
+        float sample_ampl = sqrtf(in[i].real() * in[i].real() + in[i].imag() * in[i].imag());
+        avg_ampl = avg_ampl + (sample_ampl - win_samples[win_index]) * inv_win_length;
+        win_samples[win_index] = sample_ampl;
+        win_index = (win_index + 1) % win_length;
+
+        //Threshold for detecting negative/positive edges
+        float sample_thresh = avg_ampl * THRESH_FRACTION;
+
+        //Tracking DC offset (only during T1)
+        dc_est =  dc_est + (in[i] - dc_samples[dc_index]) * inv_dc_length;
+        dc_samples[dc_index] = in[i];
+        dc_index = (dc_index + 1) % dc_length;
+
+        n_samples++;
+
+        // Potitive edge -> Negative edge
+        if( sample_ampl < sample_thresh && signal_state == POS_EDGE)
+        {
+          n_samples = 0;
+          signal_state = NEG_EDGE;
+        }
+        // Negative edge -> Positive edge
+        else if (sample_ampl > sample_thresh && signal_state == NEG_EDGE)
+        {
+          signal_state = POS_EDGE;
+          if (n_samples > n_samples_PW/2)
+            num_pulses++;
+          else
+            num_pulses = 0;
+          n_samples = 0;
+        }
+
+        if(n_samples > n_samples_T1 && signal_state == POS_EDGE && num_pulses > NUM_PULSES_COMMAND)
+        {
+          detected = true;
+          num_pulses = 0;
+          n_samples = 1;
+          return i + 1;
+        }
+      }
+      return n_items;
+    }
+
+    float gate_tracker::dc_noise() const
+    {
+      float power = 0;
+      for(int i = 0; i < dc_length; i++)
+        power += std::norm(dc_samples[i] - dc_est);
+      return power * inv_dc_length;
+    }
+
+    void gate_tracker::track_amplitude_scalar(const gr_complex * in, int n_items)
+    {
+      for(int i = 0; i < n_items; i++)
+      {
+        float sample_ampl = sqrtf(in[i].real() * in[i].real() + in[i].imag() * in[i].imag());
+        avg_ampl = avg_ampl + (sample_ampl - win_samples[win_index]) * inv_win_length;
+        win_samples[win_index] = sample_ampl;
+        win_index = (win_index + 1) % win_length;
+      }
+    }
+
+    void gate_tracker::amplitude_block(const gr_complex * in, int n_items)
+    {
+      volk_32fc_magnitude_32f(&magn[0], in, n_items);
+
+      // Samples leaving the window: from the window buffer, then from this block
+      int n_ring = std::min(n_items, win_length);
+      read_ring(win_samples, win_index, &old_magn[0], n_ring);
+      if (n_items > n_ring)
+        memcpy(&old_magn[n_ring], &magn[0], sizeof(float) * (n_items - n_ring));
+
+      volk_32f_x2_subtract_32f(&avg[0], &magn[0], &old_magn[0], n_items);
+      volk_32f_s32f_multiply_32f(&avg[0], &avg[0], inv_win_length, n_items);
+
+      // Running average as a prefix sum of the window updates
+      float a = avg_ampl;
+      for(int i = 0; i < n_items; i++)
+      {
+        a = a + avg[i];
+        avg[i] = a;
+      }
+
+      volk_32f_s32f_multiply_32f(&thresh[0], &avg[0], THRESH_FRACTION, n_items);
+    }
+
+    void gate_tracker::commit_amplitude(int n_items)
+    {
+      if (n_items == 0)
+        return;
+      avg_ampl = avg[n_items - 1];
+      write_ring(win_samples, win_index, &magn[0], n_items);
+      win_index = (win_index + n_items) % win_length;
+    }
+
+    void gate_tracker::commit_dc(const gr_complex * in, int n_items)
+    {
+      for(int i = 0; i < n_items; i++)
+        dc_est = dc_est + dc_delta[i];
+      write_ring(dc_samples, dc_index, in, n_items);
+      dc_index = (dc_index + n_items) % dc_length;
+    }
+
+    void gate_tracker::track_amplitude_volk(const gr_complex * in, int n_items)
+    {
+      for(int processed = 0; processed < n_items; )
+      {
+        int n = std::min(n_items - processed, BLOCK_SIZE);
+        amplitude_block(&in[processed], n);
+        commit_amplitude(n);
+        processed += n;
+      }
+    }
+
+    int gate_tracker::seek_command_volk(const gr_complex * in, int n_items)
+    {
+      detected = false;
+
+      int processed = 0;
+      while (processed < n_items && !detected)
+      {
+        const gr_complex * block = &in[processed];
+        int n = std::min(n_items - processed, BLOCK_SIZE);
+
+        amplitude_block(block, n);
+
+        // DC offset updates
+        int n_ring = std::min(n, dc_length);
+        read_ring(dc_samples, dc_index, &old_dc[0], n_ring);
+        if (n > n_ring)
+          memcpy(&old_dc[n_ring], block, sizeof(gr_complex) * (n - n_ring));
+        volk_32f_x2_subtract_32f((float *) &dc_delta[0], (const float *) block, (const float *) &old_dc[0], 2 * n);
+        volk_32f_s32f_multiply_32f((float *) &dc_delta[0], (const float *) &dc_delta[0], inv_dc_length, 2 * n);
+
+        for(int i = 0; i < n; i++)
+        {
+          below[i] = magn[i] < thresh[i];
+          above[i] = magn[i] > thresh[i];
+        }
+
+        // Edge state machine, advanced from one threshold crossing to the next
+        int end = n;
+        int i = 0;
+        while (i < n)
+        {
+          if (signal_state == POS_EDGE)
+          {
+            const uint8_t * edge = (const uint8_t *) memchr(&below[i], 1, n - i);
+            int j = edge ? edge - &below[0] : n;
+
+            if (num_pulses > NUM_PULSES_COMMAND)
+            {
+              // First sample at which more than n_samples_T1 samples have passed since the edge
+              int t = i + std::max(0, n_samples_T1 - n_samples);
+              if (t < j)
+              {
+                detected = true;
+                num_pulses = 0;
+                n_samples = 1;
+                end = t + 1;
+                break;
+              }
+            }
+
+            if (j == n)
+            {
+              n_samples += n - i;
+              i = n;
+            }
+            else
+            {
+              n_samples = 0;
+              signal_state = NEG_EDGE;
+              i = j + 1;
+            }
+          }
+          else
+          {
+            const uint8_t * edge = (const uint8_t *) memchr(&above[i], 1, n - i);
+            int j = edge ? edge - &above[0] : n;
+
+            if (j == n)
+            {
+              n_samples += n - i;
+              i = n;
+            }
+            else
+            {
+              n_samples += j - i + 1;
+              signal_state = POS_EDGE;
+              if (n_samples > n_samples_PW/2)
+                num_pulses++;
+              else
+                num_pulses = 0;
+              n_samples = 0;
+              i = j + 1;
+            }
+          }
+        }
+
+        commit_amplitude(end);
+        commit_dc(block, end);
+        processed += end;
+      }
+      return processed;
+    }
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,102 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_GATE_TRACKER_H
+#define INCLUDED_RFID_GATE_TRACKER_H
+
+#include <rfid/api.h>
+#include <gnuradio/gr_complex.h>
+#include <vector>
+#include <stdint.h>
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Amplitude/DC tracking and reader command detection of the gate.
+     *
+     * The block-wise path computes magnitudes and window updates with VOLK
+     * kernels and only runs the edge state machine at threshold crossings.
+     * The scalar path processes one sample at a time and is the reference:
+     * both paths produce bit-exact results.
+     */
+    class RFID_API gate_tracker
+    {
+      public:
+        gate_tracker(int win_length, int dc_length, int n_samples_T1, int n_samples_PW, bool use_volk = true);
+
+        /*!
+         * Track amplitude and DC offset and look for the end of a reader
+         * command. Returns the number of samples processed; if a command was
+         * detected the last processed sample is the first sample of the tag reply.
+         */
+        int seek_command(const gr_complex * in, int n_items);
+
+        // Track amplitude only (gate open)
+        void track_amplitude(const gr_complex * in, int n_items);
+
+        bool command_detected() const { return detected; }
+        gr_complex dc_offset() const { return dc_est; }
+        // Power of the samples in the DC window around the DC offset, one pass over the window
+        float dc_noise() const;
+        float avg_amplitude() const { return avg_ampl; }
+
+        // Number of samples since the last edge
+        void reset_count(int n) { n_samples = n; }
+
+        // Back to the state after construction: empty windows, no edge seen
+        void reset();
+
+        // T1, DC window and PIE pulse width of a new link (BLF, Tari); a new DC window starts empty
+        void set_timing(int dc_length, int n_samples_T1, int n_samples_PW);
+
+      private:
+        enum SIGNAL_STATE {NEG_EDGE, POS_EDGE};
+
+        int   n_samples, n_samples_T1, n_samples_PW;
+        int  win_index, dc_index, win_length, dc_length;
+        float avg_ampl, num_pulses, inv_win_length, inv_dc_length;
+        bool use_volk, detected;
+
+        std::vector<float> win_samples;
+        std::vector<gr_complex> dc_samples;
+        gr_complex dc_est;
+
+        SIGNAL_STATE signal_state;
+
+        // Scratch buffers of the block-wise path
+        std::vector<float> magn, old_magn, avg, thresh;
+        std::vector<gr_complex> dc_delta, old_dc;
+        std::vector<uint8_t> below, above;
+
+        int seek_command_scalar(const gr_complex * in, int n_items);
+        int seek_command_volk(const gr_complex * in, int n_items);
+        void track_amplitude_scalar(const gr_complex * in, int n_items);
+        void track_amplitude_volk(const gr_complex * in, int n_items);
+
+        void amplitude_block(const gr_complex * in, int n_items);
+        void commit_amplitude(int n_items);
+        void commit_dc(const gr_complex * in, int n_items);
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_GATE_TRACKER_H */
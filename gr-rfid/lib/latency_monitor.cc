@@ -0,0 +1,208 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "latency_monitor.h"
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+      const char * INTERVAL_NAMES[N_LATENCY_INTERVALS] = {"burst", "decode", "dispatch", "emit", "turnaround"};
+    }
+
+    const int latency_monitor::N_BINS;
+    const int latency_monitor::RING_SIZE;
+
+    latency_monitor::latency_monitor()
+      : last_sink(0), t2_us(T2_D), committed(0), incomplete(0), t2_violations(0)
+    {
+      for (int s = 0; s < N_LATENCY_STAGES; s++)
+        pending[s] = 0;
+      for (int i = 0; i < N_LATENCY_INTERVALS; i++)
+      {
+        for (int k = 0; k < N_BINS; k++)
+          hist[i][k] = 0;
+        max_us[i] = 0;
+      }
+      for (int k = 0; k < RING_SIZE; k++)
+        ring[k].seq = 0;
+    }
+
+    uint64_t latency_monitor::now()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void latency_monitor::stamp(LATENCY_STAGE stage, uint64_t t_ns)
+    {
+      if (stage == STAGE_SINK)
+        commit(t_ns);
+      else
+        pending[stage].store(t_ns, std::memory_order_release);
+    }
+
+    float latency_monitor::interval(const slot_record & r, LATENCY_INTERVAL i)
+    {
+      static const LATENCY_STAGE FROM[N_LATENCY_INTERVALS] = {STAGE_GATE_OPEN, STAGE_GATE_CLOSE, STAGE_DECODED, STAGE_EMIT, STAGE_GATE_CLOSE};
+      static const LATENCY_STAGE TO[N_LATENCY_INTERVALS]   = {STAGE_GATE_CLOSE, STAGE_DECODED, STAGE_EMIT, STAGE_SINK, STAGE_SINK};
+      return (r.t[TO[i]] - r.t[FROM[i]]) / 1e3f;
+    }
+
+    // Reader thread only
+    void latency_monitor::commit(uint64_t sink_ns)
+    {
+      slot_record r;
+      for (int s = 0; s < STAGE_SINK; s++)
+        r.t[s] = pending[s].load(std::memory_order_acquire);
+      r.t[STAGE_SINK] = sink_ns;
+
+      // A reply received after the previous emission, stamped in pipeline order
+      bool valid = r.t[STAGE_GATE_OPEN] > last_sink;
+      for (int s = 1; s < N_LATENCY_STAGES; s++)
+        valid = valid && r.t[s] >= r.t[s - 1];
+      last_sink = sink_ns;
+      if (!valid)
+      {
+        incomplete.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      for (int i = 0; i < N_LATENCY_INTERVALS; i++)
+      {
+        float us = interval(r, (LATENCY_INTERVAL) i);
+        hist[i][bin(us)].fetch_add(1, std::memory_order_relaxed);
+        float m = max_us[i].load(std::memory_order_relaxed);
+        while (us > m && !max_us[i].compare_exchange_weak(m, us, std::memory_order_relaxed))
+          ;
+      }
+      if (interval(r, LAT_TURNAROUND) > t2())
+        t2_violations.fetch_add(1, std::memory_order_relaxed);
+
+      long n = committed.load(std::memory_order_relaxed);
+      ring_entry & e = ring[n % RING_SIZE];
+      e.seq.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      e.r = r;
+      e.seq.fetch_add(1, std::memory_order_release);
+      committed.store(n + 1, std::memory_order_release);
+    }
+
+    int latency_monitor::bin(float us)
+    {
+      if (!(us >= 1))
+        return 0;
+      int k = 1 + (int) std::floor(4 * std::log2(us));
+      // Rounding of log2 near the edges
+      if (us >= bin_upper_edge(k))
+        k++;
+      else if (us < bin_upper_edge(k - 1))
+        k--;
+      return std::min(N_BINS - 1, k);
+    }
+
+    float latency_monitor::bin_upper_edge(int k)
+    {
+      return k == 0 ? 1 : std::pow(2.0f, k / 4.0f);
+    }
+
+    std::vector<long> latency_monitor::histogram(LATENCY_INTERVAL i) const
+    {
+      std::vector<long> counts(N_BINS);
+      for (int k = 0; k < N_BINS; k++)
+        counts[k] = hist[i][k].load(std::memory_order_relaxed);
+      return counts;
+    }
+
+    float latency_monitor::percentile(LATENCY_INTERVAL i, float p) const
+    {
+      std::vector<long> counts = histogram(i);
+      long total = 0;
+      for (int k = 0; k < N_BINS; k++)
+        total += counts[k];
+      if (total == 0)
+        return 0;
+
+      long target = std::max(1L, (long) std::ceil(p / 100 * total));
+      long cumulative = 0;
+      for (int k = 0; k < N_BINS - 1; k++)
+      {
+        cumulative += counts[k];
+        if (cumulative >= target)
+          return std::min(bin_upper_edge(k), max(i));
+      }
+      return max(i);
+    }
+
+    float latency_monitor::max(LATENCY_INTERVAL i) const
+    {
+      return max_us[i].load(std::memory_order_relaxed);
+    }
+
+    std::vector<latency_monitor::slot_record> latency_monitor::recent(int n) const
+    {
+      long end = committed.load(std::memory_order_acquire);
+      long begin = std::max(0L, end - std::min(n, RING_SIZE));
+
+      std::vector<slot_record> records;
+      records.reserve(end - begin);
+      for (long k = begin; k < end; k++)
+      {
+        const ring_entry & e = ring[k % RING_SIZE];
+        uint32_t seq = e.seq.load(std::memory_order_acquire);
+        slot_record r = e.r;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Skip entries overwritten by newer slots meanwhile
+        if ((seq & 1) == 0 && e.seq.load(std::memory_order_relaxed) == seq)
+          records.push_back(r);
+      }
+      return records;
+    }
+
+    std::string latency_monitor::summary() const
+    {
+      std::ostringstream out;
+      out << std::fixed << std::setprecision(1);
+      out << "Turnaround latency (us) over " << n_slots() << " slots, " << n_incomplete() << " incomplete" << std::endl;
+      for (int i = 0; i < N_LATENCY_INTERVALS; i++)
+      {
+        LATENCY_INTERVAL li = (LATENCY_INTERVAL) i;
+        out << "  " << std::left << std::setw(11) << INTERVAL_NAMES[i] << std::right
+            << " p50 " << std::setw(8) << percentile(li, 50)
+            << " p90 " << std::setw(8) << percentile(li, 90)
+            << " p99 " << std::setw(8) << percentile(li, 99)
+            << " max " << std::setw(8) << max(li) << std::endl;
+      }
+      out << "  T2 margin   p1 " << t2() - percentile(LAT_TURNAROUND, 99)
+          << " worst " << t2() - max(LAT_TURNAROUND)
+          << " (T2 " << t2() << "), violations " << n_t2_violations() << std::endl;
+      return out.str();
+    }
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,113 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_LATENCY_MONITOR_H
+#define INCLUDED_RFID_LATENCY_MONITOR_H
+
+#include <rfid/api.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Per-slot turnaround timestamps of a reader chain.
+     *
+     * Each stage is stamped by the single thread that owns it: the gate
+     * (open, close), the decoder (event posted) and the reader (emission
+     * start, samples handed to the sink). The sink stamp closes the slot:
+     * the reader thread then checks that the stamps are in order and fresh,
+     * adds the intervals to the histograms and pushes the record into a
+     * ring. Histograms are atomic counters and ring entries are guarded by
+     * a sequence number, so neither the blocks nor the queries take a lock.
+     *
+     * Histogram bin 0 holds intervals below 1 us, bin k > 0 holds
+     * [2^((k-1)/4), 2^(k/4)) us, the last bin everything above.
+     */
+    class RFID_API latency_monitor
+    {
+      public:
+        static const int N_BINS = 64;
+        static const int RING_SIZE = 1024;
+
+        struct slot_record
+        {
+          uint64_t t[N_LATENCY_STAGES];   // ns, steady clock
+        };
+
+        latency_monitor();
+
+        static uint64_t now();
+
+        // The sink stamp commits the slot
+        void stamp(LATENCY_STAGE stage) { stamp(stage, now()); }
+        void stamp(LATENCY_STAGE stage, uint64_t t_ns);
+
+        // Interval of a committed slot, in us
+        static float interval(const slot_record & r, LATENCY_INTERVAL i);
+
+        long n_slots() const { return committed.load(std::memory_order_acquire); }
+        long n_incomplete() const { return incomplete.load(std::memory_order_relaxed); }
+        long n_t2_violations() const { return t2_violations.load(std::memory_order_relaxed); }
+
+        // Turnaround budget of the link, us (T2_D by default)
+        void set_t2(float us) { t2_us.store(us, std::memory_order_relaxed); }
+        float t2() const { return t2_us.load(std::memory_order_relaxed); }
+
+        std::vector<long> histogram(LATENCY_INTERVAL i) const;
+        float percentile(LATENCY_INTERVAL i, float p) const;   // upper edge of the bin, us
+        float max(LATENCY_INTERVAL i) const;                   // us
+
+        // Up to n most recent committed slots, oldest first
+        std::vector<slot_record> recent(int n) const;
+
+        // One line per interval: p50, p90, p99, max; T2 margin and violations
+        std::string summary() const;
+
+        static int bin(float us);
+        static float bin_upper_edge(int k);
+
+      private:
+        std::atomic<uint64_t> pending[N_LATENCY_STAGES];
+        uint64_t last_sink;
+
+        std::atomic<long> hist[N_LATENCY_INTERVALS][N_BINS];
+        std::atomic<float> max_us[N_LATENCY_INTERVALS];
+        std::atomic<float> t2_us;
+        std::atomic<long> committed, incomplete, t2_violations;
+
+        struct ring_entry
+        {
+          std::atomic<uint32_t> seq;     // odd while being written
+          slot_record r;
+        };
+        ring_entry ring[RING_SIZE];
+
+        void commit(uint64_t sink_ns);
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_LATENCY_MONITOR_H */
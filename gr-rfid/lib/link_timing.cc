@@ -0,0 +1,60 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include "link_timing.h"
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+      // The gate opens this much before the nominal T1
+      const float T1_GATE_FRACTION = 0.96;
+    }
+
+    link_timing::link_timing(float blf, int dr, float tari_d, float data1)
+      : blf(blf), dr(dr), tari_d(tari_d), data1(data1)
+    {
+      pw_d = tari_d / 2;
+      rtcal_d = (1 + data1) * tari_d;
+      t4_d = 2 * rtcal_d;
+
+      trcal_d = (dr ? 64.0f / 3 : 8.0f) / blf * 1e6;
+      tag_bit_d = 1e6 / blf;
+      t1_d = T1_GATE_FRACTION * std::max(rtcal_d, 10 * tag_bit_d);
+      dc_d = std::min((float) DC_SIZE_D, t1_d / 2);
+      t2_d = std::min((float) T2_D, 20 * tag_bit_d);
+    }
+
+    bool link_timing::valid() const
+    {
+      // Relative margin for the rounding of TRcal
+      const float eps = 1e-4;
+      return blf >= BLF_MIN * (1 - eps) && blf <= BLF_MAX * (1 + eps) &&
+             tari_d >= TARI_MIN_D * (1 - eps) && tari_d <= TARI_MAX_D * (1 + eps) &&
+             data1 >= DATA1_MIN_T * (1 - eps) && data1 <= DATA1_MAX_T * (1 + eps) &&
+             trcal_d >= 1.1f * rtcal_d * (1 - eps) && trcal_d <= 3 * rtcal_d * (1 + eps);
+    }
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,74 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_LINK_TIMING_H
+#define INCLUDED_RFID_LINK_TIMING_H
+
+#include <rfid/api.h>
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Durations of both links that follow from the BLF and the Tari.
+     *
+     * The reader encodes data-0 as one Tari and data-1 as 1.5 to 2 Tari,
+     * each ending with a low pulse of half a Tari; RTcal = data-0 + data-1
+     * and commands are at least T4 = 2 RTcal apart.
+     * BLF = DR / TRcal, DR being 8 or 64/3. A reply starts T1 =
+     * max(RTcal, 10 / BLF) after the last rising edge of the command; the
+     * gate opens 4% earlier and estimates the DC offset over the second
+     * half of that interval at most. The reader has T2 <= 20 / BLF to
+     * answer, capped at T2_D. At the default BLF and Tari these are
+     * PW_D, RTCAL_D, T4_D, T1_D, DC_SIZE_D and T2_D.
+     */
+    struct RFID_API link_timing
+    {
+      float blf;          // Hz
+      int dr;             // DR field of the Query: 0 -> 8, 1 -> 64/3
+      float tari_d;       // us, data-0
+      float data1;        // data-1 length in Tari
+      float pw_d;         // us, low pulse of a PIE symbol
+      float rtcal_d;      // us
+      float t4_d;         // us, minimum time between commands
+      float trcal_d;      // us
+      float tag_bit_d;    // us, one FM0 bit (1 / BLF)
+      float t1_d;         // us, end of a command to gate opening
+      float dc_d;         // us, DC offset window before the gate opens
+      float t2_d;         // us, reader turnaround budget after a reply
+
+      link_timing(float blf = T_READER_FREQ, int dr = DR, float tari_d = TARI_D, float data1 = DATA1_T);
+
+      // Gen2 limits: BLF_MIN <= BLF <= BLF_MAX, TARI_MIN_D <= Tari <= TARI_MAX_D,
+      // DATA1_MIN_T <= data-1 <= DATA1_MAX_T, 1.1 RTcal <= TRcal <= 3 RTcal
+      bool valid() const;
+
+      bool operator==(const link_timing & other) const
+      {
+        return blf == other.blf && dr == other.dr && tari_d == other.tari_d && data1 == other.data1;
+      }
+      bool operator!=(const link_timing & other) const { return !(*this == other); }
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_LINK_TIMING_H */
@@ -0,0 +1,90 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_PACKED_BITS_H
+#define INCLUDED_RFID_PACKED_BITS_H
+
+#include <stdint.h>
+#include <string.h>
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Fixed-size bit vector in transmission order.
+     *
+     * Bit 0 is the first received bit and the MSB of word 0, so that
+     * fields and bytes of a reply are read with shifts of whole words.
+     * Unused bits of the last word are zero.
+     */
+    template <int N>
+    class packed_bits
+    {
+      public:
+        static const int n_bits = N;
+        static const int n_words = (N + 63) / 64;
+        static const int n_bytes = (N + 7) / 8;
+
+        packed_bits() { clear(); }
+
+        void clear() { memset(w, 0, sizeof(w)); }
+
+        bool get(int i) const { return (w[i >> 6] >> (63 - (i & 63))) & 1; }
+
+        void set(int i, bool bit)
+        {
+          uint64_t mask = uint64_t(1) << (63 - (i & 63));
+          w[i >> 6] = bit ? (w[i >> 6] | mask) : (w[i >> 6] & ~mask);
+        }
+
+        // Bits [first, first + n) as an integer, first bit MSB (n <= 64)
+        uint64_t field(int first, int n) const
+        {
+          int word = first >> 6, offset = first & 63;
+          uint64_t v = w[word] << offset;
+          if (offset + n > 64)
+            v |= w[word + 1] >> (64 - offset);
+          return v >> (64 - n);
+        }
+
+        // Byte i, i.e. bits [8i, 8i + 8)
+        uint8_t byte(int i) const { return w[i >> 3] >> (56 - 8 * (i & 7)); }
+
+        // Copy bytes [first, first + n) to out
+        void bytes(int first, int n, uint8_t * out) const
+        {
+          for (int i = 0; i < n; i++)
+            out[i] = byte(first + i);
+        }
+
+        uint64_t * words() { return w; }
+        const uint64_t * words() const { return w; }
+
+        bool operator==(const packed_bits & other) const { return memcmp(w, other.w, sizeof(w)) == 0; }
+        bool operator!=(const packed_bits & other) const { return !(*this == other); }
+
+      private:
+        uint64_t w[n_words];
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_PACKED_BITS_H */
@@ -0,0 +1,122 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <algorithm>
+#include <string.h>
+#include <volk/volk.h>
+#include "preamble_sync.h"
+
+namespace gr {
+  namespace rfid {
+
+    preamble_sync::preamble_sync(const std::vector<float> & preamble, float spacing, float data_offset, float search_window)
+      : peak_corr(0), interpolate(false)
+    {
+      set_template(preamble, spacing, data_offset);
+      set_search_window(search_window);
+    }
+
+    void preamble_sync::set_template(const std::vector<float> & preamble, float spacing, float data_offset)
+    {
+      this->data_offset = data_offset;
+      offsets.clear();
+      weights.clear();
+      tap_norm = 0;
+      for (int j = 0; j < preamble.size(); j++)
+      {
+        if (preamble[j] == 0)
+          continue;
+        offsets.push_back((int) (j * spacing));
+        weights.push_back(preamble[j] > 0 ? 1 : -1);
+        tap_norm += 1;
+      }
+    }
+
+    void preamble_sync::set_search_window(float search_window)
+    {
+      this->search_window = search_window;
+      acc.resize(std::ceil(search_window));
+      corr.resize(acc.size());
+    }
+
+    gr_complex preamble_sync::channel_estimate(const gr_complex * in, int index) const
+    {
+      gr_complex h(0,0);
+      for (int k = 0; k < offsets.size(); k++)
+        h += weights[k] * in[index + offsets[k]];
+      return h / tap_norm;
+    }
+
+    float preamble_sync::sync(const gr_complex * in, int size, gr_complex & h_est)
+    {
+      // Candidate offsets, without reading past the end of the reply
+      int n_corr = std::min((int) acc.size(), size - offsets.back());
+      if (n_corr <= 0)
+      {
+        h_est = gr_complex(0,0);
+        peak_corr = 0;
+        return data_offset;
+      }
+
+      // Correlation with the sparse template for all candidate offsets
+      float * sum = (float *) &acc[0];
+      memcpy(sum, &in[offsets[0]], sizeof(gr_complex) * n_corr);
+      if (weights[0] < 0)
+        volk_32f_s32f_multiply_32f(sum, sum, -1, 2 * n_corr);
+      for (int k = 1; k < offsets.size(); k++)
+      {
+        const float * shifted = (const float *) &in[offsets[k]];
+        if (weights[k] > 0)
+          volk_32f_x2_add_32f(sum, sum, shifted, 2 * n_corr);
+        else
+          volk_32f_x2_subtract_32f(sum, sum, shifted, 2 * n_corr);
+      }
+      volk_32fc_magnitude_squared_32f(&corr[0], &acc[0], n_corr);
+
+      uint16_t max_index = 0;
+      volk_32f_index_max_16u(&max_index, &corr[0], n_corr);
+      peak_corr = corr[max_index];
+
+      if (!interpolate || max_index == 0 || max_index == n_corr - 1)
+      {
+        h_est = channel_estimate(in, max_index);
+        return (int) (max_index + data_offset);
+      }
+
+      // Parabolic interpolation of the correlation peak
+      float left = corr[max_index - 1], right = corr[max_index + 1];
+      float denom = left - 2 * peak_corr + right;
+      float delta = denom < 0 ? 0.5 * (left - right) / denom : 0;
+      delta = std::max(-0.5f, std::min(0.5f, delta));
+
+      // Channel estimate between the two nearest offsets
+      int first = delta < 0 ? max_index - 1 : max_index;
+      float frac = delta < 0 ? 1 + delta : delta;
+      h_est = (1 - frac) * channel_estimate(in, first) + frac * channel_estimate(in, first + 1);
+
+      return max_index + delta + data_offset;
+    }
+  } /* namespace rfid */
+} /* namespace gr */
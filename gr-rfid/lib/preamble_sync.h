@@ -0,0 +1,79 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_PREAMBLE_SYNC_H
+#define INCLUDED_RFID_PREAMBLE_SYNC_H
+
+#include <rfid/api.h>
+#include <gnuradio/gr_complex.h>
+#include <vector>
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Preamble synchronization of a tag reply.
+     *
+     * The preamble template is kept as a sparse list of (offset, +-1) taps.
+     * The correlation for every candidate offset of the search window is
+     * computed at once, one VOLK add/subtract of the shifted input per tap.
+     */
+    class RFID_API preamble_sync
+    {
+      public:
+        /*!
+         * \param preamble template values per element (0 entries are skipped)
+         * \param spacing samples per template element
+         * \param data_offset samples from the preamble start to the first data sample
+         * \param search_window candidate preamble offsets, in samples
+         */
+        preamble_sync(const std::vector<float> & preamble, float spacing, float data_offset, float search_window);
+
+        /*!
+         * Returns the index of the first data sample after the preamble and
+         * the channel estimate at the correlation peak.
+         */
+        float sync(const gr_complex * in, int size, gr_complex & h_est);
+
+        // Correlation peak of the last sync, |sum(taps)|^2
+        float peak() const { return peak_corr; }
+
+        // Replaces the template, keeping the search window and interpolation
+        void set_template(const std::vector<float> & preamble, float spacing, float data_offset);
+        void set_search_window(float search_window);
+        float get_search_window() const { return search_window; }
+        void set_interpolation(bool interpolate) { this->interpolate = interpolate; }
+
+      private:
+        std::vector<int> offsets;
+        std::vector<float> weights;
+        float tap_norm, data_offset, search_window, peak_corr;
+        bool interpolate;
+
+        std::vector<gr_complex> acc;
+        std::vector<float> corr;
+
+        gr_complex channel_estimate(const gr_complex * in, int index) const;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_PREAMBLE_SYNC_H */
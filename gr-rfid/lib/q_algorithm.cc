@@ -0,0 +1,115 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include "q_algorithm.h"
+
+namespace gr {
+  namespace rfid {
+
+    q_algorithm::q_algorithm(int q, Q_MODE mode, float c)
+      : d_mode(mode), d_c(c)
+    {
+      start_round(q);
+      qfp = d_q;
+    }
+
+    void q_algorithm::start_round(int q)
+    {
+      d_q = std::min(std::max(q, 0), 15);
+      counts[SLOT_EMPTY] = counts[SLOT_SINGLE] = counts[SLOT_COLLISION] = 0;
+    }
+
+    Q_UPDATE q_algorithm::end_slot(SLOT_OUTCOME outcome)
+    {
+      counts[outcome]++;
+      if (d_mode != Q_FLOATING)
+        return Q_UNCHANGED;
+
+      if (outcome == SLOT_EMPTY)
+        qfp = std::max(0.0f, qfp - d_c);
+      else if (outcome == SLOT_COLLISION)
+        qfp = std::min(15.0f, qfp + d_c);
+
+      // QueryAdjust starts a new round with Q +-1
+      int q = (int) std::floor(qfp + 0.5f);
+      if (q == d_q)
+        return Q_UNCHANGED;
+      Q_UPDATE update = q > d_q ? Q_INCREMENT : Q_DECREMENT;
+      start_round(update == Q_INCREMENT ? d_q + 1 : d_q - 1);
+      return update;
+    }
+
+    int q_algorithm::end_round()
+    {
+      float backlog = -1;
+      if (d_mode == Q_SCHOUTE)
+        backlog = schoute_backlog(counts[SLOT_EMPTY], counts[SLOT_SINGLE], counts[SLOT_COLLISION]);
+      else if (d_mode == Q_VOGT)
+        backlog = vogt_backlog(counts[SLOT_EMPTY], counts[SLOT_SINGLE], counts[SLOT_COLLISION]);
+
+      if (backlog < 0)
+        start_round(d_q);
+      else
+      {
+        start_round(backlog < 1 ? 0 : (int) std::floor(std::log2(backlog) + 0.5f));
+        qfp = d_q;
+      }
+      return d_q;
+    }
+
+    float q_algorithm::schoute_backlog(int, int, int n_collided)
+    {
+      return 2.39f * n_collided;
+    }
+
+    float q_algorithm::vogt_backlog(int n_empty, int n_single, int n_collided)
+    {
+      float L = n_empty + n_single + n_collided;
+      int n_min = n_single + 2 * n_collided;
+      if (L < 2 || n_collided == 0)
+        return n_min - n_single;
+
+      // Expected empty, single and collided slots of n tags in L slots
+      float p_miss = 1 - 1 / L;
+      int best_n = n_min;
+      float best_dist = -1;
+      for (int n = n_min; n <= 2 * n_min + 16; n++)
+      {
+        float a0 = L * std::pow(p_miss, n);
+        float a1 = n * std::pow(p_miss, n - 1);
+        float a2 = L - a0 - a1;
+        float dist = (a0 - n_empty) * (a0 - n_empty) + (a1 - n_single) * (a1 - n_single) +
+                     (a2 - n_collided) * (a2 - n_collided);
+        if (best_dist < 0 || dist < best_dist)
+        {
+          best_dist = dist;
+          best_n = n;
+        }
+      }
+      return best_n - n_single;
+    }
+  } /* namespace rfid */
+} /* namespace gr */
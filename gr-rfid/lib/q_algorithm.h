@@ -0,0 +1,79 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_Q_ALGORITHM_H
+#define INCLUDED_RFID_Q_ALGORITHM_H
+
+#include <rfid/api.h>
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Slot count adaptation of an inventory from the outcome of each slot.
+     *
+     * Four modes are available:
+     *  - Q_FIXED: Q never changes
+     *  - Q_FLOATING: Gen2 Annex D, Qfp moves by C towards more slots on a
+     *    collision and fewer on an empty slot; a change of round(Qfp) is
+     *    sent as QueryAdjust in the next slot
+     *  - Q_SCHOUTE: at the end of a round the backlog is 2.39 tags per collided slot
+     *  - Q_VOGT: at the end of a round the backlog is the tag count whose expected
+     *    empty/single/collided slots are closest to the observed ones, less the singles
+     * The estimator modes set Q of the next Query to log2 of the backlog.
+     */
+    class RFID_API q_algorithm
+    {
+      public:
+        q_algorithm(int q = FIXED_Q, Q_MODE mode = Q_FIXED, float c = Q_STEP);
+
+        int q() const { return d_q; }
+        Q_MODE mode() const { return d_mode; }
+        void set_mode(Q_MODE mode) { d_mode = mode; }
+        void set_step(float c) { d_c = c; }
+
+        // Records a slot and returns the QueryAdjust to send before the next one
+        Q_UPDATE end_slot(SLOT_OUTCOME outcome);
+
+        // Closes a round of 2^q() slots and returns Q of the next Query
+        int end_round();
+
+        int n_empty() const { return counts[SLOT_EMPTY]; }
+        int n_single() const { return counts[SLOT_SINGLE]; }
+        int n_collided() const { return counts[SLOT_COLLISION]; }
+
+        // Tags left unread by a round with the given slot counts
+        static float schoute_backlog(int n_empty, int n_single, int n_collided);
+        static float vogt_backlog(int n_empty, int n_single, int n_collided);
+
+      private:
+        Q_MODE d_mode;
+        float d_c, qfp;
+        int d_q;
+        int counts[3];
+
+        void start_round(int q);
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_Q_ALGORITHM_H */
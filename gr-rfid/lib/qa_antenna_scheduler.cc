@@ -0,0 +1,162 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_antenna_scheduler.h"
+#include "antenna_scheduler.h"
+#include "slot_logic.h"
+#include <cppunit/TestAssert.h>
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+      const uint64_t MS = 1000000;   // ns
+    }
+
+    void
+    qa_antenna_scheduler::t1_dwell_rounds()
+    {
+      // 3 ports, 2 rounds each, no time limit
+      antenna_scheduler antennas(3, 2, 0);
+      antennas.start(0);
+
+      int expected[] = {0, 0, 1, 1, 2, 2, 0, 0};
+      for (int round = 0; round < 8; round++)
+      {
+        CPPUNIT_ASSERT_EQUAL(expected[round], antennas.current());
+        bool switched = antennas.end_round((round + 1) * MS);
+        CPPUNIT_ASSERT_EQUAL(round % 2 == 1, switched);
+      }
+      CPPUNIT_ASSERT_EQUAL(4L, antennas.stats(0, 8 * MS).n_rounds);
+      CPPUNIT_ASSERT_EQUAL(2L, antennas.stats(1, 8 * MS).n_rounds);
+      CPPUNIT_ASSERT_EQUAL(2L, antennas.stats(2, 8 * MS).n_rounds);
+
+      // A single port never switches
+      antenna_scheduler single(1, 1, 0.001);
+      single.start(0);
+      for (int round = 0; round < 4; round++)
+        CPPUNIT_ASSERT(!single.end_round((round + 1) * 10 * MS));
+    }
+
+    void
+    qa_antenna_scheduler::t2_dwell_time()
+    {
+      // 2 ports, 25 ms each whatever the number of rounds, switching at the end of a round
+      antenna_scheduler antennas(2, 0, 0.025);
+      antennas.start(0);
+
+      for (int t = 10; t <= 20; t += 10)
+        CPPUNIT_ASSERT(!antennas.end_round(t * MS));
+      CPPUNIT_ASSERT(antennas.end_round(30 * MS));
+      CPPUNIT_ASSERT_EQUAL(1, antennas.current());
+      CPPUNIT_ASSERT(!antennas.end_round(50 * MS));
+      CPPUNIT_ASSERT(antennas.end_round(55 * MS));
+      CPPUNIT_ASSERT_EQUAL(0, antennas.current());
+
+      // The ongoing dwell counts towards the current port
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(0.030 + 0.005, antennas.stats(0, 60 * MS).dwell_s, 1e-9);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(0.025, antennas.stats(1, 60 * MS).dwell_s, 1e-9);
+    }
+
+    void
+    qa_antenna_scheduler::t3_state_per_antenna()
+    {
+      antenna_scheduler antennas(2, 1, 0);
+      antennas.set_q_mode(Q_FLOATING);
+      antennas.set_q_step(0.5);
+      antennas.start(0);
+
+      // Port 0 sees collisions only: Q rises from FIXED_Q
+      for (int slot = 0; slot < 4; slot++)
+      {
+        antennas.q_alg().end_slot(SLOT_COLLISION);
+        antennas.count_slot(SLOT_COLLISION);
+      }
+      int q0 = antennas.q_alg().q();
+      CPPUNIT_ASSERT(q0 > FIXED_Q);
+      CPPUNIT_ASSERT(antennas.end_round(100 * MS));
+
+      // Port 1 starts from its own Q and reads 10 tags
+      CPPUNIT_ASSERT_EQUAL(FIXED_Q, antennas.q_alg().q());
+      CPPUNIT_ASSERT_EQUAL(Q_FLOATING, antennas.q_alg().mode());
+      for (int slot = 0; slot < 10; slot++)
+      {
+        antennas.q_alg().end_slot(SLOT_SINGLE);
+        antennas.count_slot(SLOT_SINGLE);
+        antennas.count_epc();
+      }
+      CPPUNIT_ASSERT(antennas.end_round(150 * MS));
+
+      // Back on port 0, with the Q it converged to
+      CPPUNIT_ASSERT_EQUAL(q0, antennas.q_alg().q());
+
+      antenna_stats s0 = antennas.stats(0, 150 * MS);
+      antenna_stats s1 = antennas.stats(1, 150 * MS);
+      CPPUNIT_ASSERT_EQUAL(4L, s0.n_slots[SLOT_COLLISION]);
+      CPPUNIT_ASSERT_EQUAL(0L, s0.n_epc);
+      CPPUNIT_ASSERT_EQUAL(10L, s1.n_slots[SLOT_SINGLE]);
+      CPPUNIT_ASSERT_EQUAL(10L, s1.n_epc);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, antennas.reads_per_s(0, 150 * MS), 1e-6);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(200.0, antennas.reads_per_s(1, 150 * MS), 1e-3);
+    }
+
+    void
+    qa_antenna_scheduler::t4_slot_logic()
+    {
+      slot_logic slots;
+      slots.q_alg() = q_algorithm(2, Q_FIXED);
+
+      // QueryRep between the 4 slots of a round, Query after the last one
+      for (int slot = 1; slot < 4; slot++)
+      {
+        CPPUNIT_ASSERT_EQUAL(SEND_QUERY_REP, slots.end_slot(SLOT_EMPTY, 0));
+        CPPUNIT_ASSERT(!slots.round_ended());
+        CPPUNIT_ASSERT_EQUAL(slot + 1, slots.slot());
+      }
+      CPPUNIT_ASSERT_EQUAL(SEND_QUERY, slots.end_slot(SLOT_EMPTY, 0));
+      CPPUNIT_ASSERT(slots.round_ended());
+      CPPUNIT_ASSERT_EQUAL(4, slots.round_slots());
+      CPPUNIT_ASSERT_EQUAL(1, slots.slot());
+      CPPUNIT_ASSERT_EQUAL(4L, slots.antennas().stats(0, 0).n_slots[SLOT_EMPTY]);
+
+      // A Q change ends the round with a QueryAdjust
+      slots.q_alg().set_mode(Q_FLOATING);
+      slots.q_alg().set_step(0.5);
+      CPPUNIT_ASSERT_EQUAL(SEND_QUERY_ADJUST, slots.end_slot(SLOT_COLLISION, 0));
+      CPPUNIT_ASSERT_EQUAL(Q_INCREMENT, slots.q_change());
+      CPPUNIT_ASSERT(slots.round_ended());
+      CPPUNIT_ASSERT_EQUAL(1, slots.round_slots());
+      CPPUNIT_ASSERT_EQUAL(8, slots.n_slots());
+
+      // New ports take over at the end of the round, each starting with START
+      slots.set_antennas(2, 1, 0);
+      while (slots.slot() < slots.n_slots())
+        CPPUNIT_ASSERT_EQUAL(SEND_QUERY_REP, slots.end_slot(SLOT_SINGLE, 10 * MS));
+      CPPUNIT_ASSERT_EQUAL(1, slots.antennas().n_antennas());
+      CPPUNIT_ASSERT_EQUAL(START, slots.end_slot(SLOT_SINGLE, 20 * MS));
+      CPPUNIT_ASSERT_EQUAL(2, slots.antennas().n_antennas());
+      CPPUNIT_ASSERT_EQUAL(0, slots.antennas().current());
+      CPPUNIT_ASSERT_EQUAL(1 << FIXED_Q, slots.n_slots());
+      CPPUNIT_ASSERT_EQUAL(START, slots.end_slot(SLOT_SINGLE, 30 * MS));
+      CPPUNIT_ASSERT_EQUAL(1, slots.antennas().current());
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
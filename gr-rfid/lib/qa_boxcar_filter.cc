@@ -0,0 +1,62 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_boxcar_filter.h"
+#include "boxcar_filter.h"
+#include <cppunit/TestAssert.h>
+#include <random>
+#include <vector>
+
+namespace gr {
+  namespace rfid {
+
+    void
+    qa_boxcar_filter::t1_matches_fir()
+    {
+      // Carrier with DC offset and noise, as at the ADC
+      std::mt19937 rng(1);
+      std::normal_distribution<float> noise(0, 0.01);
+      std::vector<gr_complex> in(100000);
+      for (int i = 0; i < in.size(); i++)
+        in[i] = gr_complex(0.2 + noise(rng), -0.1 + noise(rng));
+
+      // Running sum (taps > decim) and integrate and dump (taps <= decim)
+      const int TAPS[] = {25, 6, 3, 5, 50};
+      const int DECIM[] = {5, 1, 5, 5, 10};
+      for (int t = 0; t < 5; t++)
+      {
+        boxcar_filter boxcar(TAPS[t], DECIM[t]);
+        int n_out = (in.size() - TAPS[t]) / DECIM[t];
+        std::vector<gr_complex> out(n_out);
+        boxcar.filter(&in[0], n_out, &out[0]);
+
+        for (int k = 0; k < n_out; k++)
+        {
+          gr_complex sum(0,0);
+          for (int j = 0; j < TAPS[t]; j++)
+            sum += in[k * DECIM[t] + j];
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(sum.real(), out[k].real(), 1e-5 * TAPS[t]);
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(sum.imag(), out[k].imag(), 1e-5 * TAPS[t]);
+        }
+      }
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
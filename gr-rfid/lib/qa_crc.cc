@@ -0,0 +1,115 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_crc.h"
+#include "crc.h"
+#include "packed_bits.h"
+#include <cppunit/TestAssert.h>
+#include <random>
+#include <string.h>
+
+namespace gr {
+  namespace rfid {
+
+    void
+    qa_crc::t1_check_values()
+    {
+      // Catalogue check values over "123456789": CRC-16/GENIBUS and CRC-5/EPC
+      const char * check = "123456789";
+      packed_bits<72> bits;
+      for (int i = 0; i < 72; i++)
+        bits.set(i, (check[i / 8] >> (7 - i % 8)) & 1);
+
+      CPPUNIT_ASSERT_EQUAL(0xD64E, (int) crc16::compute((const uint8_t *) check, 9));
+      CPPUNIT_ASSERT_EQUAL(0xD64E, (int) (uint16_t) ~crc16::update_bits(crc16::PRESET, bits.words(), 0, 72));
+      CPPUNIT_ASSERT_EQUAL(0x00, (int) crc5::update_bits(crc5::PRESET, bits.words(), 0, 72));
+
+      // Select test vector (21 bits, not byte aligned)
+      const char * select = "000000000100000000010";
+      float q[21];
+      for (int i = 0; i < 21; i++)
+        q[i] = select[i] - '0';
+      CPPUNIT_ASSERT_EQUAL(0xC797, (int) (uint16_t) ~crc16::update_bits(crc16::PRESET, q, 21));
+    }
+
+    void
+    qa_crc::t2_bit_stream_matches_bitwise()
+    {
+      std::mt19937_64 rng(1);
+      packed_bits<256> bits;
+      for (int t = 0; t < 1000; t++)
+      {
+        for (int i = 0; i < 256; i++)
+          bits.set(i, rng() & 1);
+        int first = rng() % 64;
+        int n_bits = rng() % (256 - first + 1);
+
+        uint16_t crc_16 = crc16::PRESET;
+        uint8_t crc_5 = crc5::PRESET;
+        for (int i = first; i < first + n_bits; i++)
+        {
+          crc_16 = crc16::update_bit(crc_16, bits.get(i));
+          crc_5 = crc5::update_bit(crc_5, bits.get(i));
+        }
+        CPPUNIT_ASSERT_EQUAL((int) crc_16, (int) crc16::update_bits(crc16::PRESET, bits.words(), first, n_bits));
+        CPPUNIT_ASSERT_EQUAL((int) crc_5, (int) crc5::update_bits(crc5::PRESET, bits.words(), first, n_bits));
+
+        // Byte entry with slicing over the same (aligned) bits
+        uint8_t bytes[32];
+        bits.bytes(0, n_bits / 8, bytes);
+        crc_16 = crc16::PRESET;
+        for (int i = 0; i < n_bits / 8 * 8; i++)
+          crc_16 = crc16::update_bit(crc_16, bits.get(i));
+        CPPUNIT_ASSERT_EQUAL((int) crc_16, (int) crc16::update(crc16::PRESET, bytes, n_bits / 8));
+
+        if (n_bits <= 64)
+        {
+          uint64_t value = n_bits ? bits.field(first, n_bits) : 0;
+          CPPUNIT_ASSERT_EQUAL((int) crc_5, (int) crc5::compute(value, n_bits));
+        }
+      }
+    }
+
+    void
+    qa_crc::t3_epc_check()
+    {
+      std::mt19937 rng(2);
+      packed_bits<128> bits;
+      for (int i = 0; i < 112; i++)
+        bits.set(i, rng() & 1);
+      uint16_t crc = ~crc16::update_bits(crc16::PRESET, bits.words(), 0, 112);
+      for (int i = 0; i < 16; i++)
+        bits.set(112 + i, (crc >> (15 - i)) & 1);
+      CPPUNIT_ASSERT(crc16::check(bits.words(), 128));
+
+      bits.set(37, !bits.get(37));
+      CPPUNIT_ASSERT(!crc16::check(bits.words(), 128));
+    }
+
+    void
+    qa_crc::t4_query_table()
+    {
+      // Every payload behind the Query code 1000b
+      for (uint32_t payload = 0; payload < (1 << 13); payload++)
+        CPPUNIT_ASSERT_EQUAL((int) crc5::compute((0x8 << 13) | payload, 17), (int) crc5::query(payload));
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
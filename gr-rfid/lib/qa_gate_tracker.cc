@@ -0,0 +1,162 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_gate_tracker.h"
+#include "burst_gate.h"
+#include <cppunit/TestAssert.h>
+#include <algorithm>
+#include <random>
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+
+      struct gate_run
+      {
+        std::vector<int> detections;
+        std::vector<gr_complex> dc;
+        std::vector<float> noise;
+        float avg;
+      };
+
+      // Reader commands (PIE pulses) followed by a modulated tag reply, at 400 kS/s
+      std::vector<gr_complex> make_input()
+      {
+        std::mt19937 rng(1234);
+        std::normal_distribution<float> noise(0, 0.01);
+        std::vector<float> envelope;
+
+        for(int command = 0; command < 40; command++)
+        {
+          envelope.insert(envelope.end(), 600, 1.0);
+          for(int symbol = 0; symbol < 20; symbol++)
+          {
+            envelope.insert(envelope.end(), (rng() % 2 ? 3 : 1) * 5, 1.0);
+            envelope.insert(envelope.end(), 5, 0.1);
+          }
+          envelope.insert(envelope.end(), 100, 1.0);
+          for(int half_bit = 0; half_bit < 300; half_bit++)
+            envelope.insert(envelope.end(), 5, rng() % 2 ? 1.05 : 0.95);
+          envelope.insert(envelope.end(), 500, 1.0);
+        }
+
+        std::vector<gr_complex> in(envelope.size());
+        for(int i = 0; i < in.size(); i++)
+          in[i] = gr_complex(0.2, -0.1) + envelope[i] * gr_complex(0.6, 0.8) + gr_complex(noise(rng), noise(rng));
+        return in;
+      }
+
+      // Cut bursts the way gate_impl does, with work calls of random size
+      gate_run run_gate(burst_gate & gate, const std::vector<gr_complex> & in, int burst, unsigned seed)
+      {
+        std::mt19937 rng(seed);
+        gate_run result;
+        std::vector<gr_complex> out(burst);
+        std::vector<float> magn_squared(burst);
+        int i = 0;
+
+        gate.expect(burst);
+        while (i < in.size())
+        {
+          int end = std::min((int) in.size(), i + 1 + (int) (rng() % 6000));
+          while (i < end)
+          {
+            int n_out;
+            i += gate.process(&in[i], end - i, &out[gate.is_open() ? gate.burst_size() : 0], &magn_squared[0], n_out);
+            if (gate.opened())
+            {
+              result.detections.push_back(i - 1);
+              result.dc.push_back(gate.tracker().dc_offset());
+              result.noise.push_back(gate.tracker().dc_noise());
+            }
+            if (gate.closed())
+            {
+              CPPUNIT_ASSERT_EQUAL(burst, gate.burst_size());
+              CPPUNIT_ASSERT_EQUAL(std::norm(out[burst - 1]), magn_squared[burst - 1]);
+              gate.expect(burst);
+            }
+          }
+        }
+        result.avg = gate.tracker().avg_amplitude();
+        return result;
+      }
+    }
+
+    void
+    qa_gate_tracker::t1_volk_matches_scalar()
+    {
+      // 400 kS/s: window 100, DC window 48, T1 96, PW 4 samples
+      std::vector<gr_complex> in = make_input();
+      burst_gate scalar(100, 48, 96, 4, false);
+      burst_gate volk(100, 48, 96, 4, true);
+
+      gate_run expected = run_gate(scalar, in, 920, 1);
+      gate_run result = run_gate(volk, in, 920, 2);
+
+      CPPUNIT_ASSERT(expected.detections.size() > 0);
+      CPPUNIT_ASSERT(expected.detections == result.detections);
+      for(int i = 0; i < expected.dc.size(); i++)
+      {
+        CPPUNIT_ASSERT_EQUAL(expected.dc[i].real(), result.dc[i].real());
+        CPPUNIT_ASSERT_EQUAL(expected.dc[i].imag(), result.dc[i].imag());
+      }
+      CPPUNIT_ASSERT_EQUAL(expected.avg, result.avg);
+    }
+
+    void
+    qa_gate_tracker::t2_dc_noise()
+    {
+      // The DC window holds the carrier after the command: complex noise of variance 2 * 0.01^2
+      std::vector<gr_complex> in = make_input();
+      burst_gate gate(100, 48, 96, 4, true);
+      gate_run result = run_gate(gate, in, 920, 3);
+
+      CPPUNIT_ASSERT(result.noise.size() > 0);
+      float mean = 0;
+      for(int i = 0; i < result.noise.size(); i++)
+      {
+        CPPUNIT_ASSERT(result.noise[i] > 0.5 * 2e-4 && result.noise[i] < 2 * 2e-4);
+        mean += result.noise[i] / result.noise.size();
+      }
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(2e-4, mean, 0.2e-4);
+    }
+
+    void
+    qa_gate_tracker::t3_reset()
+    {
+      // After reset a tracker repeats the run of a new one, whatever it saw before
+      std::vector<gr_complex> in = make_input();
+      burst_gate fresh(100, 48, 96, 4, true);
+      burst_gate reused(100, 48, 96, 4, true);
+      gate_run expected = run_gate(fresh, in, 920, 4);
+
+      // Stopped in the middle of the first command
+      run_gate(reused, std::vector<gr_complex>(in.begin(), in.begin() + 700), 920, 5);
+      reused.reset();
+      gate_run result = run_gate(reused, in, 920, 4);
+
+      CPPUNIT_ASSERT(expected.detections.size() > 0);
+      CPPUNIT_ASSERT(expected.detections == result.detections);
+      CPPUNIT_ASSERT_EQUAL(expected.avg, result.avg);
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,48 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_GATE_TRACKER_H_
+#define _QA_GATE_TRACKER_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+namespace gr {
+  namespace rfid {
+
+    class qa_gate_tracker : public CppUnit::TestCase
+    {
+    public:
+      CPPUNIT_TEST_SUITE(qa_gate_tracker);
+      CPPUNIT_TEST(t1_volk_matches_scalar);
+      CPPUNIT_TEST(t2_dc_noise);
+      CPPUNIT_TEST(t3_reset);
+      CPPUNIT_TEST_SUITE_END();
+
+    private:
+      void t1_volk_matches_scalar();
+      void t2_dc_noise();
+      void t3_reset();
+    };
+
+  } /* namespace rfid */
+} /* namespace gr */
+
+#endif /* _QA_GATE_TRACKER_H_ */
@@ -0,0 +1,149 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_latency_monitor.h"
+#include "latency_monitor.h"
+#include <cppunit/TestAssert.h>
+#include <memory>
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+
+      // Stamps one slot, times in us from t0
+      void slot(latency_monitor & m, uint64_t t0, float open, float close, float decoded, float emit, float sink)
+      {
+        m.stamp(STAGE_GATE_OPEN, t0 + (uint64_t) (open * 1000));
+        m.stamp(STAGE_GATE_CLOSE, t0 + (uint64_t) (close * 1000));
+        m.stamp(STAGE_DECODED, t0 + (uint64_t) (decoded * 1000));
+        m.stamp(STAGE_EMIT, t0 + (uint64_t) (emit * 1000));
+        m.stamp(STAGE_SINK, t0 + (uint64_t) (sink * 1000));
+      }
+    }
+
+    void
+    qa_latency_monitor::t1_bins()
+    {
+      CPPUNIT_ASSERT_EQUAL(0, latency_monitor::bin(0));
+      CPPUNIT_ASSERT_EQUAL(0, latency_monitor::bin(0.99));
+      CPPUNIT_ASSERT_EQUAL(1, latency_monitor::bin(1));
+      CPPUNIT_ASSERT_EQUAL(1, latency_monitor::bin(1.18));
+      CPPUNIT_ASSERT_EQUAL(2, latency_monitor::bin(1.2));
+      CPPUNIT_ASSERT_EQUAL(latency_monitor::N_BINS - 1, latency_monitor::bin(1e9));
+
+      // Every value lies below the upper edge of its bin
+      for (float us = 0.5; us < 4e4; us *= 1.07)
+      {
+        int k = latency_monitor::bin(us);
+        CPPUNIT_ASSERT(us < latency_monitor::bin_upper_edge(k));
+        CPPUNIT_ASSERT(k == 0 || us >= latency_monitor::bin_upper_edge(k - 1));
+      }
+    }
+
+    void
+    qa_latency_monitor::t2_intervals()
+    {
+      std::unique_ptr<latency_monitor> m(new latency_monitor);
+      uint64_t t0 = 1000000;
+
+      // Turnaround of 100 us in 90 slots, 300 us in 10
+      for (int i = 0; i < 100; i++, t0 += 2000000)
+        slot(*m, t0, 0, 400, 420, 430 + (i >= 90) * 200, 500 + (i >= 90) * 200);
+
+      CPPUNIT_ASSERT_EQUAL(100L, m->n_slots());
+      CPPUNIT_ASSERT_EQUAL(0L, m->n_incomplete());
+      CPPUNIT_ASSERT_EQUAL(0L, m->n_t2_violations());
+      CPPUNIT_ASSERT_EQUAL(100L, m->histogram(LAT_BURST)[latency_monitor::bin(400)]);
+
+      float p50 = m->percentile(LAT_TURNAROUND, 50);
+      CPPUNIT_ASSERT(p50 > 100 && p50 < 100 * 1.19);
+      float p90 = m->percentile(LAT_TURNAROUND, 90);
+      CPPUNIT_ASSERT(p90 > 100 && p90 < 100 * 1.19);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(300, m->percentile(LAT_TURNAROUND, 99), 1e-3);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(300, m->max(LAT_TURNAROUND), 1e-3);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(20, m->max(LAT_DECODE), 1e-3);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(210, m->max(LAT_DISPATCH), 1e-3);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(70, m->max(LAT_EMIT), 1e-3);
+    }
+
+    void
+    qa_latency_monitor::t3_incomplete()
+    {
+      std::unique_ptr<latency_monitor> m(new latency_monitor);
+
+      // Nothing stamped before the first command
+      m->stamp(STAGE_SINK, 1000);
+      CPPUNIT_ASSERT_EQUAL(1L, m->n_incomplete());
+
+      slot(*m, 2000000, 0, 400, 420, 430, 500);
+      CPPUNIT_ASSERT_EQUAL(1L, m->n_slots());
+
+      // No reply since the last command: stamps of the previous slot
+      m->stamp(STAGE_EMIT, 4000000);
+      m->stamp(STAGE_SINK, 4010000);
+      CPPUNIT_ASSERT_EQUAL(2L, m->n_incomplete());
+
+      // Reply still being decoded
+      m->stamp(STAGE_GATE_OPEN, 5000000);
+      m->stamp(STAGE_GATE_CLOSE, 5400000);
+      m->stamp(STAGE_EMIT, 5410000);
+      m->stamp(STAGE_SINK, 5420000);
+      CPPUNIT_ASSERT_EQUAL(3L, m->n_incomplete());
+      CPPUNIT_ASSERT_EQUAL(1L, m->n_slots());
+    }
+
+    void
+    qa_latency_monitor::t4_t2_violations()
+    {
+      std::unique_ptr<latency_monitor> m(new latency_monitor);
+
+      slot(*m, 1000000, 0, 400, 420, 430, 400 + T2_D - 1);
+      slot(*m, 2000000, 0, 400, 420, 430, 400 + T2_D + 100);
+      CPPUNIT_ASSERT_EQUAL(2L, m->n_slots());
+      CPPUNIT_ASSERT_EQUAL(1L, m->n_t2_violations());
+      CPPUNIT_ASSERT(m->summary().find("violations 1") != std::string::npos);
+    }
+
+    void
+    qa_latency_monitor::t5_recent()
+    {
+      std::unique_ptr<latency_monitor> m(new latency_monitor);
+      const int N = latency_monitor::RING_SIZE + 100;
+
+      uint64_t t0 = 1000000;
+      for (int i = 0; i < N; i++, t0 += 2000000)
+        slot(*m, t0, 0, 400, 420, 430, 500 + i % 100);
+
+      std::vector<latency_monitor::slot_record> r = m->recent(10);
+      CPPUNIT_ASSERT_EQUAL(10, (int) r.size());
+      for (int i = 0; i < 10; i++)
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(100 + (N - 10 + i) % 100, latency_monitor::interval(r[i], LAT_TURNAROUND), 1e-3);
+
+      // Older slots have been overwritten
+      r = m->recent(N);
+      CPPUNIT_ASSERT_EQUAL(latency_monitor::RING_SIZE, (int) r.size());
+      CPPUNIT_ASSERT_EQUAL(r.back().t[STAGE_SINK], m->recent(1)[0].t[STAGE_SINK]);
+      for (int i = 1; i < r.size(); i++)
+        CPPUNIT_ASSERT(r[i].t[STAGE_GATE_OPEN] > r[i - 1].t[STAGE_SINK]);
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
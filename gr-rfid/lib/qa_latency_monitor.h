@@ -0,0 +1,52 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_LATENCY_MONITOR_H_
+#define _QA_LATENCY_MONITOR_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+namespace gr {
+  namespace rfid {
+
+    class qa_latency_monitor : public CppUnit::TestCase
+    {
+    public:
+      CPPUNIT_TEST_SUITE(qa_latency_monitor);
+      CPPUNIT_TEST(t1_bins);
+      CPPUNIT_TEST(t2_intervals);
+      CPPUNIT_TEST(t3_incomplete);
+      CPPUNIT_TEST(t4_t2_violations);
+      CPPUNIT_TEST(t5_recent);
+      CPPUNIT_TEST_SUITE_END();
+
+    private:
+      void t1_bins();
+      void t2_intervals();
+      void t3_incomplete();
+      void t4_t2_violations();
+      void t5_recent();
+    };
+
+  } /* namespace rfid */
+} /* namespace gr */
+
+#endif /* _QA_LATENCY_MONITOR_H_ */
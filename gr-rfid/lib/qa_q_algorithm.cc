@@ -0,0 +1,173 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_q_algorithm.h"
+#include "q_algorithm.h"
+#include "waveform_cache.h"
+#include <cppunit/TestAssert.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+
+      // PIE bits of a burst that starts with frame-sync: each symbol ends at a
+      // rising edge, a data-1 is longer than half of RTcal
+      std::vector<int> pie_bits(const std::vector<float> & burst)
+      {
+        std::vector<int> rises;
+        for (int i = 1; i < burst.size(); i++)
+          if (burst[i] > 0.5 && burst[i - 1] <= 0.5)
+            rises.push_back(i);
+
+        std::vector<int> bits;
+        int rtcal = rises[2] - rises[1];
+        for (int k = 3; k < rises.size(); k++)
+          bits.push_back(2 * (rises[k] - rises[k - 1]) > rtcal);
+        return bits;
+      }
+
+      // Framed slotted ALOHA with the reader's round logic: a round ends
+      // after 2^Q slots or at a QueryAdjust, and unread tags then pick a
+      // new slot. Returns the slots needed to read n_tags.
+      int inventory(Q_MODE mode, int n_tags, std::mt19937 & rng)
+      {
+        q_algorithm q_alg(0, mode);
+        std::vector<int> slot(n_tags);
+        int unread = n_tags, n_slots = 0;
+
+        while (unread > 0 && n_slots < 100000)
+        {
+          for (int i = 0; i < unread; i++)
+            slot[i] = rng() % (1 << q_alg.q());
+
+          bool adjusted = false;
+          for (int s = 0; s < (1 << q_alg.q()) && !adjusted && n_slots < 100000; s++)
+          {
+            int replies = 0, replier = -1;
+            for (int i = 0; i < unread; i++)
+              if (slot[i] == s)
+              {
+                replies++;
+                replier = i;
+              }
+            n_slots++;
+
+            SLOT_OUTCOME outcome = replies == 0 ? SLOT_EMPTY : (replies == 1 ? SLOT_SINGLE : SLOT_COLLISION);
+            if (outcome == SLOT_SINGLE)
+              slot[replier] = slot[--unread];
+            adjusted = q_alg.end_slot(outcome) != Q_UNCHANGED;
+          }
+          if (!adjusted)
+            q_alg.end_round();
+        }
+        return n_slots;
+      }
+    }
+
+    void
+    qa_q_algorithm::t1_estimators()
+    {
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(23.9, q_algorithm::schoute_backlog(5, 7, 10), 1e-4);
+
+      // Expected slot counts of 50 tags in 32 slots
+      float L = 32, n = 50;
+      float a0 = L * std::pow(1 - 1 / L, n);
+      float a1 = n * std::pow(1 - 1 / L, n - 1);
+      int e = std::floor(a0 + 0.5f), s = std::floor(a1 + 0.5f), c = L - e - s;
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(n - s, q_algorithm::vogt_backlog(e, s, c), 3);
+
+      // No collision, nothing left
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(0, q_algorithm::vogt_backlog(10, 6, 0), 1e-6);
+    }
+
+    void
+    qa_q_algorithm::t2_floating_q_steps()
+    {
+      q_algorithm q_alg(4, Q_FLOATING, 0.3);
+
+      // Qfp 4.3, 4.6: Q 4 -> 5
+      CPPUNIT_ASSERT_EQUAL(Q_UNCHANGED, q_alg.end_slot(SLOT_COLLISION));
+      CPPUNIT_ASSERT_EQUAL(Q_INCREMENT, q_alg.end_slot(SLOT_COLLISION));
+      CPPUNIT_ASSERT_EQUAL(5, q_alg.q());
+      CPPUNIT_ASSERT_EQUAL(0, q_alg.n_collided());
+
+      // Singles leave Qfp alone, Qfp 4.3 rounds to 4
+      CPPUNIT_ASSERT_EQUAL(Q_UNCHANGED, q_alg.end_slot(SLOT_SINGLE));
+      CPPUNIT_ASSERT_EQUAL(Q_DECREMENT, q_alg.end_slot(SLOT_EMPTY));
+      CPPUNIT_ASSERT_EQUAL(4, q_alg.q());
+
+      // Floor at 0
+      q_algorithm low(0, Q_FLOATING, 0.3);
+      for (int i = 0; i < 10; i++)
+        CPPUNIT_ASSERT_EQUAL(Q_UNCHANGED, low.end_slot(SLOT_EMPTY));
+      CPPUNIT_ASSERT_EQUAL(0, low.q());
+
+      // Fixed Q never changes
+      q_algorithm fixed(3, Q_FIXED);
+      for (int i = 0; i < 8; i++)
+        CPPUNIT_ASSERT_EQUAL(Q_UNCHANGED, fixed.end_slot(SLOT_COLLISION));
+      CPPUNIT_ASSERT_EQUAL(3, fixed.end_round());
+    }
+
+    void
+    qa_q_algorithm::t3_inventory_100_tags()
+    {
+      // Ideal framed ALOHA needs e * n slots; starting from Q = 0 allow twice that
+      const int N_TAGS = 100;
+      const Q_MODE MODES[] = {Q_FLOATING, Q_SCHOUTE, Q_VOGT};
+      for (int m = 0; m < 3; m++)
+      {
+        std::mt19937 rng(m);
+        int n_slots = 0;
+        for (int r = 0; r < 20; r++)
+          n_slots += inventory(MODES[m], N_TAGS, rng);
+        CPPUNIT_ASSERT(n_slots / 20 < 2 * M_E * N_TAGS);
+      }
+
+      // With Q = 0 and 100 tags every slot collides
+      std::mt19937 rng(0);
+      CPPUNIT_ASSERT_EQUAL(100000, inventory(Q_FIXED, N_TAGS, rng));
+    }
+
+    void
+    qa_q_algorithm::t4_query_adjust_updn()
+    {
+      // QueryAdjust: 1001, session S0, UpDn 110 up, 000 unchanged, 011 down (010 is ignored by tags)
+      const int UPDN[3][3] = { {1,1,0}, {0,0,0}, {0,1,1} };
+      const Q_UPDATE UPDATES[] = {Q_INCREMENT, Q_UNCHANGED, Q_DECREMENT};
+      waveform_cache waveforms(1000000);
+      std::vector<float> burst;
+
+      for (int u = 0; u < 3; u++)
+      {
+        burst.resize(waveforms.max_burst_size());
+        burst.resize(waveforms.emit_query_adjust(UPDATES[u], &burst[0]));
+        int expected[] = {1,0,0,1, 0,0, UPDN[u][0], UPDN[u][1], UPDN[u][2]};
+        std::vector<int> bits = pie_bits(burst);
+        CPPUNIT_ASSERT(bits == std::vector<int>(expected, expected + 9));
+      }
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
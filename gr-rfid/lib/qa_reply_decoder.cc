@@ -0,0 +1,300 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_reply_decoder.h"
+#include "reply_decoder.h"
+#include "rfid/global_vars.h"
+#include <cppunit/TestAssert.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+// Allocation counter for the whole test binary, only counting while enabled
+namespace {
+  std::atomic<bool> count_allocations(false);
+  std::atomic<long> n_allocations(0);
+}
+
+void * operator new(std::size_t size)
+{
+  if (count_allocations)
+    n_allocations++;
+  void * p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void * p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+  free(p);
+}
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+
+      const int S_RATE = 400000;
+      const float N_SAMPLES_TAG_BIT = TAG_BIT_D * S_RATE / 1e6;  // 10 samples
+
+      // Matched filter output (moving sum over a half-bit) of an FM0 reply
+      // preceded by lead samples of (DC removed) carrier
+      std::vector<gr_complex> make_reply(const std::vector<int> & bits, int lead, int size,
+                                         gr_complex h = gr_complex(0.3, -0.4))
+      {
+        const int half_bit = N_SAMPLES_TAG_BIT / 2;
+
+        std::vector<float> levels(lead, 0);
+        for (int j = 0; j < 2 * TAG_PREAMBLE_BITS; j++)
+          levels.insert(levels.end(), half_bit, TAG_PREAMBLE[j] ? 1 : -1);
+        float level = 1;
+        for (int i = 0; i < bits.size(); i++)
+        {
+          level = -level;
+          levels.insert(levels.end(), half_bit, level);
+          if (bits[i] == 0)
+            level = -level;
+          levels.insert(levels.end(), half_bit, level);
+        }
+        levels.resize(size + half_bit, 0);
+
+        std::vector<gr_complex> out(size);
+        for (int m = 0; m < size; m++)
+        {
+          float sum = 0;
+          for (int k = 0; k < half_bit; k++)
+            sum += levels[m + k];
+          out[m] = sum * h;
+        }
+        return out;
+      }
+
+      std::vector<int> random_bits(int n, unsigned seed)
+      {
+        std::mt19937 rng(seed);
+        std::vector<int> bits(n);
+        for (int i = 0; i < n; i++)
+          bits[i] = rng() & 1;
+        bits[n - 1] = 1;  // dummy bit
+        return bits;
+      }
+
+      void add_noise(std::vector<gr_complex> & in, float power, std::mt19937 & rng)
+      {
+        std::normal_distribution<float> noise(0, std::sqrt(power / 2));
+        for (int i = 0; i < in.size(); i++)
+          in[i] += gr_complex(noise(rng), noise(rng));
+      }
+
+      std::vector<float> magnitudes(const std::vector<gr_complex> & in)
+      {
+        std::vector<float> magn_squared(in.size());
+        for (int i = 0; i < in.size(); i++)
+          magn_squared[i] = std::norm(in[i]);
+        return magn_squared;
+      }
+    }
+
+    void
+    qa_reply_decoder::t1_decode_rn16()
+    {
+      int size = (RN16_BITS + TAG_PREAMBLE_BITS + 2) * N_SAMPLES_TAG_BIT;
+      reply_decoder decoder(N_SAMPLES_TAG_BIT);
+
+      for (int lead = 0; lead < N_SAMPLES_TAG_BIT; lead += 3)
+      {
+        std::vector<int> bits = random_bits(RN16_BITS, lead);
+        std::vector<gr_complex> in = make_reply(bits, lead, size);
+
+        rn16_bits rn16;
+        CPPUNIT_ASSERT_EQUAL(SLOT_SINGLE, decoder.decode_rn16(&in[0], size, rn16));
+        for (int i = 0; i < RN16_BITS - 1; i++)
+          CPPUNIT_ASSERT_EQUAL((bool) bits[i], rn16.get(i));
+      }
+
+      // Burst cut before the end of the RN16
+      std::vector<gr_complex> in = make_reply(random_bits(RN16_BITS, 0), 0, size);
+      rn16_bits rn16;
+      CPPUNIT_ASSERT_EQUAL(SLOT_EMPTY, decoder.decode_rn16(&in[0], size / 2, rn16));
+    }
+
+    void
+    qa_reply_decoder::t2_decode_epc()
+    {
+      int size = (EPC_BITS + TAG_PREAMBLE_BITS + 2) * N_SAMPLES_TAG_BIT;
+      reply_decoder decoder(N_SAMPLES_TAG_BIT);
+
+      for (int mode = TIMING_GRID_SEARCH; mode <= TIMING_EARLY_LATE; mode++)
+      {
+        decoder.timing().set_mode((TIMING_MODE) mode);
+        std::vector<int> bits = random_bits(EPC_BITS, 10 + mode);
+        std::vector<gr_complex> in = make_reply(bits, 4, size);
+        std::vector<float> magn_squared = magnitudes(in);
+
+        epc_bits epc;
+        decoder.decode_epc(&in[0], size, &magn_squared[0], size, epc);
+        for (int i = 0; i < EPC_BITS - 1; i++)
+          CPPUNIT_ASSERT_EQUAL((bool) bits[i], epc.get(i));
+      }
+    }
+
+    void
+    qa_reply_decoder::t3_no_allocations()
+    {
+      int size = (EPC_BITS + TAG_PREAMBLE_BITS + 2) * N_SAMPLES_TAG_BIT;
+      reply_decoder decoder(N_SAMPLES_TAG_BIT);
+      decoder.sync().set_interpolation(true);
+
+      std::vector<gr_complex> rn16_in = make_reply(random_bits(RN16_BITS, 1), 2, size);
+      std::vector<gr_complex> epc_in = make_reply(random_bits(EPC_BITS, 2), 7, size);
+      std::vector<float> magn_squared = magnitudes(epc_in);
+      rn16_bits rn16;
+      epc_bits epc;
+
+      n_allocations = 0;
+      count_allocations = true;
+      for (int i = 0; i < 100; i++)
+      {
+        decoder.timing().set_mode((TIMING_MODE) (i % 3));
+        decoder.decode_rn16(&rn16_in[0], size, rn16);
+        decoder.decode_epc(&epc_in[0], size, &magn_squared[0], size, epc);
+      }
+      count_allocations = false;
+
+      CPPUNIT_ASSERT_EQUAL(0L, (long) n_allocations);
+    }
+
+    void
+    qa_reply_decoder::t4_packed_fields()
+    {
+      std::vector<int> bits = random_bits(EPC_BITS - 1, 3);
+      epc_bits epc;
+      for (int i = 0; i < epc_bits::n_bits; i++)
+        epc.set(i, bits[i]);
+
+      // Fields within a word and across the word boundary
+      for (int first = 0; first < epc_bits::n_bits - 16; first += 7)
+      {
+        uint64_t expected = 0;
+        for (int i = first; i < first + 16; i++)
+          expected = (expected << 1) | bits[i];
+        CPPUNIT_ASSERT_EQUAL(expected, epc.field(first, 16));
+      }
+      for (int i = 0; i < epc_bits::n_bytes; i++)
+        CPPUNIT_ASSERT_EQUAL((uint64_t) epc.byte(i), epc.field(8 * i, 8));
+    }
+
+    void
+    qa_reply_decoder::t5_classify_rn16()
+    {
+      int size = (RN16_BITS + TAG_PREAMBLE_BITS + 2) * N_SAMPLES_TAG_BIT;
+      const float half_bit = N_SAMPLES_TAG_BIT / 2;
+      const gr_complex h1(0.3, -0.4), h2(-0.2, -0.45);   // |h1| = 0.5, |h2| ~ 0.49
+      // Noise power for 10 dB at the matched filter output of h1
+      const float noise_10db = std::norm(h1 * half_bit) / 10;
+
+      reply_decoder decoder(N_SAMPLES_TAG_BIT);
+      rn16_bits rn16;
+      int counts[3][3] = {{0}};
+
+      for (int t = 0; t < 50; t++)
+      {
+        std::mt19937 rng(t);
+        std::vector<int> bits1 = random_bits(RN16_BITS, 100 + t), bits2 = random_bits(RN16_BITS, 200 + t);
+        int lead = 2 + t % 4;
+
+        std::vector<gr_complex> empty(size, gr_complex(0, 0));
+        add_noise(empty, noise_10db, rng);
+        counts[SLOT_EMPTY][decoder.decode_rn16(&empty[0], size, rn16)]++;
+
+        std::vector<gr_complex> single = make_reply(bits1, lead, size, h1);
+        add_noise(single, noise_10db, rng);
+        counts[SLOT_SINGLE][decoder.decode_rn16(&single[0], size, rn16)]++;
+
+        // Two tags of similar power, slightly apart in time
+        std::vector<gr_complex> collision = make_reply(bits1, lead, size, h1);
+        std::vector<gr_complex> second = make_reply(bits2, lead + t % 2, size, h2);
+        for (int i = 0; i < size; i++)
+          collision[i] += second[i];
+        add_noise(collision, noise_10db, rng);
+        counts[SLOT_COLLISION][decoder.decode_rn16(&collision[0], size, rn16)]++;
+      }
+
+      // Allow a few misclassifications, none between empty and collided
+      CPPUNIT_ASSERT(counts[SLOT_EMPTY][SLOT_EMPTY] >= 48);
+      CPPUNIT_ASSERT(counts[SLOT_SINGLE][SLOT_SINGLE] >= 48);
+      CPPUNIT_ASSERT(counts[SLOT_COLLISION][SLOT_COLLISION] >= 45);
+      CPPUNIT_ASSERT_EQUAL(0, counts[SLOT_EMPTY][SLOT_COLLISION]);
+
+      // A second tag 20 dB down is captured by the first one
+      std::vector<gr_complex> captured = make_reply(random_bits(RN16_BITS, 5), 3, size, h1);
+      std::vector<gr_complex> weak = make_reply(random_bits(RN16_BITS, 6), 3, size, h2 * 0.1f);
+      for (int i = 0; i < size; i++)
+        captured[i] += weak[i];
+      CPPUNIT_ASSERT_EQUAL(SLOT_SINGLE, decoder.decode_rn16(&captured[0], size, rn16));
+
+      // Classification off
+      decoder.set_classification(false);
+      std::vector<gr_complex> empty(size, gr_complex(0, 0));
+      std::mt19937 rng(0);
+      add_noise(empty, noise_10db, rng);
+      CPPUNIT_ASSERT_EQUAL(SLOT_SINGLE, decoder.decode_rn16(&empty[0], size, rn16));
+    }
+
+    void
+    qa_reply_decoder::t6_channel_estimate()
+    {
+      // RSSI and phase of a read: |h|^2 of the preamble estimate over the gate noise, arg(h)
+      int size = (EPC_BITS + TAG_PREAMBLE_BITS + 2) * N_SAMPLES_TAG_BIT;
+      const float half_bit = N_SAMPLES_TAG_BIT / 2;
+      const gr_complex h = std::polar(0.5f, 2.0f);
+      const float noise = std::norm(h * half_bit) / 1000;   // 30 dB at the matched filter output
+      reply_decoder decoder(N_SAMPLES_TAG_BIT);
+      std::mt19937 rng(6);
+
+      for (int t = 0; t < 10; t++)
+      {
+        std::vector<gr_complex> in = make_reply(random_bits(EPC_BITS, 300 + t), 3 + t % 4, size, h);
+        add_noise(in, noise, rng);
+        std::vector<float> magn_squared = magnitudes(in);
+        epc_bits epc;
+        decoder.decode_epc(&in[0], size, &magn_squared[0], size, epc);
+
+        // The preamble averages the noise over its taps: within 5% and 0.05 rad
+        gr_complex h_est = decoder.channel_estimate();
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(half_bit * std::abs(h), std::abs(h_est), 0.05 * half_bit * std::abs(h));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(std::arg(h), std::arg(h_est), 0.05);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(30, reply_decoder::rssi_db(h_est, noise), 0.5);
+      }
+
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(-6.0206, reply_decoder::rssi_db(gr_complex(0, 0.5), 1), 1e-3);
+      // No noise measured yet: clamped floor instead of an infinite RSSI
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(120 - 6.0206, reply_decoder::rssi_db(gr_complex(0.5, 0), 0), 1e-2);
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,54 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_REPLY_DECODER_H_
+#define _QA_REPLY_DECODER_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+namespace gr {
+  namespace rfid {
+
+    class qa_reply_decoder : public CppUnit::TestCase
+    {
+    public:
+      CPPUNIT_TEST_SUITE(qa_reply_decoder);
+      CPPUNIT_TEST(t1_decode_rn16);
+      CPPUNIT_TEST(t2_decode_epc);
+      CPPUNIT_TEST(t3_no_allocations);
+      CPPUNIT_TEST(t4_packed_fields);
+      CPPUNIT_TEST(t5_classify_rn16);
+      CPPUNIT_TEST(t6_channel_estimate);
+      CPPUNIT_TEST_SUITE_END();
+
+    private:
+      void t1_decode_rn16();
+      void t2_decode_epc();
+      void t3_no_allocations();
+      void t4_packed_fields();
+      void t5_classify_rn16();
+      void t6_channel_estimate();
+    };
+
+  } /* namespace rfid */
+} /* namespace gr */
+
+#endif /* _QA_REPLY_DECODER_H_ */
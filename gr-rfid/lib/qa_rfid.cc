@@ -26,11 +26,31 @@
  */
 
 #include "qa_rfid.h"
+#include "qa_antenna_scheduler.h"
+#include "qa_boxcar_filter.h"
+#include "qa_crc.h"
+#include "qa_gate_tracker.h"
+#include "qa_latency_monitor.h"
+#include "qa_q_algorithm.h"
+#include "qa_reply_decoder.h"
+#include "qa_stats_board.h"
+#include "qa_tag_population.h"
+#include "qa_tag_table.h"
 
 CppUnit::TestSuite *
 qa_rfid::suite()
 {
   CppUnit::TestSuite *s = new CppUnit::TestSuite("rfid");
+  s->addTest(gr::rfid::qa_antenna_scheduler::suite());
+  s->addTest(gr::rfid::qa_boxcar_filter::suite());
+  s->addTest(gr::rfid::qa_crc::suite());
+  s->addTest(gr::rfid::qa_gate_tracker::suite());
+  s->addTest(gr::rfid::qa_latency_monitor::suite());
+  s->addTest(gr::rfid::qa_q_algorithm::suite());
+  s->addTest(gr::rfid::qa_reply_decoder::suite());
+  s->addTest(gr::rfid::qa_stats_board::suite());
+  s->addTest(gr::rfid::qa_tag_population::suite());
+  s->addTest(gr::rfid::qa_tag_table::suite());
 
   return s;
 }
@@ -0,0 +1,119 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_stats_board.h"
+#include "stats_board.h"
+#include "rfid/global_vars.h"
+#include <cppunit/TestAssert.h>
+#include <atomic>
+#include <thread>
+
+namespace gr {
+  namespace rfid {
+
+    void
+    qa_stats_board::t1_snapshot()
+    {
+      stats_board board;
+      inventory_stats s = board.snapshot();
+      CPPUNIT_ASSERT_EQUAL(0L, s.n_epc_correct);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(0, s.crc_failure_rate, 1e-12);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(0, s.mean_round_reads_per_s, 1e-12);
+
+      // Private copies are not visible before they are published
+      board.decoder().n_epc_correct = 3;
+      board.decoder().n_epc_crc_fail = 1;
+      board.decoder().n_unique_tags = 2;
+      CPPUNIT_ASSERT_EQUAL(0L, board.snapshot().n_epc_correct);
+      board.publish_decoder();
+
+      board.reader().n_queries_sent = 10;
+      board.reader().n_slots[SLOT_EMPTY] = 5;
+      board.reader().n_slots[SLOT_SINGLE] = 4;
+      board.reader().n_slots[SLOT_COLLISION] = 1;
+      board.reader().n_rounds = 2;
+      board.reader().sum_round_reads_per_s = 300;
+      board.reader().last_round_reads_per_s = 100;
+      board.publish_reader();
+
+      s = board.snapshot();
+      CPPUNIT_ASSERT_EQUAL(3L, s.n_epc_correct);
+      CPPUNIT_ASSERT_EQUAL(1L, s.n_epc_crc_fail);
+      CPPUNIT_ASSERT_EQUAL(2L, s.n_unique_tags);
+      CPPUNIT_ASSERT_EQUAL(10L, s.n_queries_sent);
+      CPPUNIT_ASSERT_EQUAL(5L, s.n_slots_empty);
+      CPPUNIT_ASSERT_EQUAL(4L, s.n_slots_single);
+      CPPUNIT_ASSERT_EQUAL(1L, s.n_slots_collided);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(0.25, s.crc_failure_rate, 1e-12);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(150, s.mean_round_reads_per_s, 1e-12);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(100, s.last_round_reads_per_s, 1e-12);
+      CPPUNIT_ASSERT(s.elapsed_s > 0);
+      CPPUNIT_ASSERT(s.reads_per_s > 0);
+    }
+
+    void
+    qa_stats_board::t2_concurrent_writers()
+    {
+      // Each writer keeps two counters equal; a torn read would see them differ
+      const long N = 200000;
+      stats_board board;
+      std::atomic<bool> done(false);
+      bool consistent = true;   // asserted after join: a failed assertion would terminate the poller thread
+
+      std::thread decoder([&] {
+        for (long i = 1; i <= N; i++)
+        {
+          board.decoder().n_epc_correct = i;
+          board.decoder().n_unique_tags = i;
+          board.publish_decoder();
+        }
+      });
+      std::thread reader([&] {
+        for (long i = 1; i <= N; i++)
+        {
+          board.reader().n_queries_sent = i;
+          board.reader().n_slots[SLOT_SINGLE] = i;
+          board.publish_reader();
+        }
+      });
+      std::thread poller([&] {
+        long last = 0;
+        while (!done)
+        {
+          inventory_stats s = board.snapshot();
+          consistent = consistent && s.n_epc_correct == s.n_unique_tags
+                       && s.n_queries_sent == s.n_slots_single && s.n_epc_correct >= last;
+          last = s.n_epc_correct;
+        }
+      });
+
+      decoder.join();
+      reader.join();
+      done = true;
+      poller.join();
+      CPPUNIT_ASSERT(consistent);
+
+      inventory_stats s = board.snapshot();
+      CPPUNIT_ASSERT_EQUAL(N, s.n_epc_correct);
+      CPPUNIT_ASSERT_EQUAL(N, s.n_queries_sent);
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,46 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_STATS_BOARD_H_
+#define _QA_STATS_BOARD_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+namespace gr {
+  namespace rfid {
+
+    class qa_stats_board : public CppUnit::TestCase
+    {
+    public:
+      CPPUNIT_TEST_SUITE(qa_stats_board);
+      CPPUNIT_TEST(t1_snapshot);
+      CPPUNIT_TEST(t2_concurrent_writers);
+      CPPUNIT_TEST_SUITE_END();
+
+    private:
+      void t1_snapshot();
+      void t2_concurrent_writers();
+    };
+
+  } /* namespace rfid */
+} /* namespace gr */
+
+#endif /* _QA_STATS_BOARD_H_ */
@@ -0,0 +1,284 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_tag_population.h"
+#include "tag_population.h"
+#include "replay_engine.h"
+#include "waveform_cache.h"
+#include "link_timing.h"
+#include "slot_logic.h"
+#include "crc.h"
+#include "rfid/global_vars.h"
+#include <cppunit/TestAssert.h>
+#include <string.h>
+#include <vector>
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+
+      const int DAC_RATE = 1000000;
+      const int ADC_RATE = 2000000;
+      const int DECIM = 5;
+
+      // Reader commands through the tags and the receive chain
+      struct air_link
+      {
+        waveform_cache waveforms;
+        tag_population population;
+        replay_engine engine;
+        std::vector<float> tx;
+        std::vector<gr_complex> rx;
+
+        air_link(int n_tags, unsigned seed, int decim = DECIM, const link_timing & link = link_timing())
+          : waveforms(DAC_RATE), population(DAC_RATE, ADC_RATE, n_tags, seed), engine(ADC_RATE, decim, link)
+        {
+          waveforms.set_link(link);
+          tx.resize(waveforms.max_burst_size() + waveforms.n_cwsettle_s);
+          rx.resize(tx.size() * population.interpolation());
+        }
+
+        // Sends the first n samples of tx
+        void send(int n)
+        {
+          population.process(&tx[0], n, &rx[0]);
+          engine.process(&rx[0], n * population.interpolation());
+        }
+
+        long n_rn16(SLOT_OUTCOME outcome) const { return engine.stats().n_rn16[outcome]; }
+      };
+
+      // Slot outcome seen by the receive chain since the counts were taken
+      SLOT_OUTCOME last_outcome(const air_link & l, const long before[3])
+      {
+        for (int o = SLOT_EMPTY; o <= SLOT_COLLISION; o++)
+          if (l.n_rn16((SLOT_OUTCOME) o) > before[o])
+            return (SLOT_OUTCOME) o;
+        return SLOT_EMPTY;
+      }
+    }
+
+    void
+    qa_tag_population::t1_query_ack()
+    {
+      air_link l(1, 1);
+
+      l.send(l.waveforms.emit_settle(&l.tx[0]));
+      l.send(l.waveforms.emit_query(query_word(false, 0), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.population.stats().n_reply_slots);
+      CPPUNIT_ASSERT_EQUAL(1L, l.n_rn16(SLOT_SINGLE));
+
+      l.send(l.waveforms.emit_ack(l.engine.last_rn16().field(0, 16), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.engine.stats().n_epc_correct);
+      CPPUNIT_ASSERT(l.engine.last_epc() == l.population.epc(0));
+      CPPUNIT_ASSERT_EQUAL(1, l.population.n_reads(0));
+
+      // The QueryRep moves the tag to inventoried B: no reply to Queries of target A
+      l.send(l.waveforms.emit_query_rep(&l.tx[0]));
+      l.send(l.waveforms.emit_query(query_word(false, 0), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.population.stats().n_reply_slots);
+      CPPUNIT_ASSERT_EQUAL(2L, l.n_rn16(SLOT_EMPTY));
+
+      // A wrong RN16 is not acknowledged
+      l.send(l.waveforms.emit_power_down(&l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.population.stats().n_power_offs);
+      l.send(l.waveforms.emit_settle(&l.tx[0]));
+      l.send(l.waveforms.emit_query(query_word(false, 0), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(2L, l.population.stats().n_reply_slots);
+      l.send(l.waveforms.emit_ack(~l.engine.last_rn16().field(0, 16), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.population.stats().n_acked);
+      CPPUNIT_ASSERT_EQUAL(0L, l.population.stats().n_crc_errors);
+    }
+
+    void
+    qa_tag_population::t2_collision()
+    {
+      // Two tags in a single slot, different channels
+      int n_collided = 0;
+      for (int seed = 0; seed < 10; seed++)
+      {
+        air_link l(2, seed);
+        l.send(l.waveforms.emit_settle(&l.tx[0]));
+        l.send(l.waveforms.emit_query(query_word(false, 0), &l.tx[0]));
+        CPPUNIT_ASSERT_EQUAL(1L, l.population.stats().n_collided_slots);
+        n_collided += l.n_rn16(SLOT_COLLISION);
+      }
+      CPPUNIT_ASSERT(n_collided >= 8);
+    }
+
+    void
+    qa_tag_population::t3_select()
+    {
+      air_link l(4, 3);
+
+      // Select (SL, assert matching / deassert others) on the first 16 EPC bits of tag 2
+      const int fields[] = {1,0,1,0, 1,0,0, 0,0,0, 0,1, 0,0,1,0,0,0,0,0, 0,0,0,1,0,0,0,0};
+      std::vector<float> select(fields, fields + 28);
+      for (int i = 0; i < 16; i++)
+        select.push_back(l.population.epc(2).get(16 + i));
+      select.push_back(0);
+      uint16_t crc = ~crc16::update_bits(crc16::PRESET, &select[0], select.size());
+      for (int i = 15; i >= 0; i--)
+        select.push_back((crc >> i) & 0x01);
+      l.waveforms.set_select(select);
+
+      l.send(l.waveforms.emit_settle(&l.tx[0]));
+      l.send(l.waveforms.emit_select(&l.tx[0]));
+      l.send(l.waveforms.emit_query(query_word(true, 0), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.n_rn16(SLOT_SINGLE));
+
+      l.send(l.waveforms.emit_ack(l.engine.last_rn16().field(0, 16), &l.tx[0]));
+      CPPUNIT_ASSERT(l.engine.last_epc() == l.population.epc(2));
+      CPPUNIT_ASSERT_EQUAL(1, l.population.n_tags_read());
+      CPPUNIT_ASSERT_EQUAL(0L, l.population.stats().n_crc_errors);
+    }
+
+    void
+    qa_tag_population::t4_inventory_50_tags()
+    {
+      // Closed loop: the reader logic of reader_impl with floating Q
+      const int N_TAGS = 50;
+      air_link l(N_TAGS, 4);
+      l.population.set_snr(25, 6);
+      l.population.set_blf_tolerance(0.005);
+      slot_logic slots;
+      slots.q_alg() = q_algorithm(4, Q_FLOATING);
+
+      long before[3];
+      memcpy(before, l.engine.stats().n_rn16, sizeof(before));
+      l.send(l.waveforms.emit_settle(&l.tx[0]));
+      l.send(l.waveforms.emit_query(query_word(false, slots.q_alg().q()), &l.tx[0]));
+      int n_slots = 0;
+      long n_wrong_epc = 0;
+      while (l.population.n_tags_read() < N_TAGS && n_slots < 2000)
+      {
+        SLOT_OUTCOME outcome = last_outcome(l, before);
+        if (outcome == SLOT_SINGLE)
+        {
+          long n_correct = l.engine.stats().n_epc_correct;
+          l.send(l.waveforms.emit_ack(l.engine.last_rn16().field(0, 16), &l.tx[0]));
+          if (l.engine.stats().n_epc_correct > n_correct)
+          {
+            bool known = false;
+            for (int i = 0; i < N_TAGS; i++)
+              known |= l.engine.last_epc() == l.population.epc(i);
+            n_wrong_epc += !known;
+          }
+        }
+        n_slots++;
+
+        memcpy(before, l.engine.stats().n_rn16, sizeof(before));
+        // A single antenna never moves to START
+        switch (slots.end_slot(outcome, 0))
+        {
+          case SEND_QUERY_ADJUST:
+            l.send(l.waveforms.emit_query_adjust(slots.q_change(), &l.tx[0]));
+            break;
+          case SEND_QUERY_REP:
+            l.send(l.waveforms.emit_query_rep(&l.tx[0]));
+            break;
+          default:
+            l.send(l.waveforms.emit_query(query_word(false, slots.q_alg().q()), &l.tx[0]));
+            break;
+        }
+      }
+
+      CPPUNIT_ASSERT_EQUAL(N_TAGS, l.population.n_tags_read());
+      CPPUNIT_ASSERT_EQUAL(0L, n_wrong_epc);
+      CPPUNIT_ASSERT(n_slots < 2 * M_E * N_TAGS);
+    }
+
+    void
+    qa_tag_population::t5_miller()
+    {
+      // The M of the Query sets the tag encoding; the receive chain follows it
+      for (int m = 2; m <= 8; m *= 2)
+      {
+        air_link l(1, m);
+        l.waveforms.set_cycles_per_symbol(m);
+        l.engine.set_cycles_per_symbol(m);
+
+        l.send(l.waveforms.emit_settle(&l.tx[0]));
+        l.send(l.waveforms.emit_query(query_word(false, 0, m), &l.tx[0]));
+        CPPUNIT_ASSERT_EQUAL(1L, l.n_rn16(SLOT_SINGLE));
+
+        l.send(l.waveforms.emit_ack(l.engine.last_rn16().field(0, 16), &l.tx[0]));
+        CPPUNIT_ASSERT_EQUAL(1L, l.engine.stats().n_epc_correct);
+        CPPUNIT_ASSERT(l.engine.last_epc() == l.population.epc(0));
+
+        // An FM0 receiver does not decode the Miller reply
+        l.engine.set_cycles_per_symbol(1);
+        l.send(l.waveforms.emit_power_down(&l.tx[0]));
+        l.send(l.waveforms.emit_settle(&l.tx[0]));
+        l.send(l.waveforms.emit_query(query_word(false, 0, m), &l.tx[0]));
+        l.send(l.waveforms.emit_ack(l.engine.last_rn16().field(0, 16), &l.tx[0]));
+        CPPUNIT_ASSERT_EQUAL(1L, l.engine.stats().n_epc_correct);
+      }
+    }
+
+    void
+    qa_tag_population::t6_link_frequency()
+    {
+      // 160 kHz with DR 64/3: TRcal 133 us, 12.5 samples per tag bit without decimation
+      air_link l(1, 6, 1, link_timing(160e3, 1));
+      CPPUNIT_ASSERT(l.waveforms.get_link().valid());
+
+      l.send(l.waveforms.emit_settle(&l.tx[0]));
+      l.send(l.waveforms.emit_query(query_word(false, 0, 1, 1), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.n_rn16(SLOT_SINGLE));
+
+      l.send(l.waveforms.emit_ack(l.engine.last_rn16().field(0, 16), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.engine.stats().n_epc_correct);
+      CPPUNIT_ASSERT(l.engine.last_epc() == l.population.epc(0));
+      CPPUNIT_ASSERT_EQUAL(0L, l.population.stats().n_crc_errors);
+    }
+
+    void
+    qa_tag_population::t7_short_tari()
+    {
+      // Tari 6.25 us with data-1 of 1.5 Tari (RTcal 15.6 us), 200 kHz with DR 8 (TRcal 40 us)
+      air_link l(1, 7, 1, link_timing(200e3, 0, 6.25, 1.5));
+      CPPUNIT_ASSERT(l.waveforms.get_link().valid());
+
+      // The Query takes less than a quarter of its air time at the default Tari
+      waveform_cache defaults(DAC_RATE);
+      int n_query = l.waveforms.emit_query(query_word(false, 0), &l.tx[0]) - l.waveforms.n_cwquery_s;
+      int n_default = defaults.emit_query(query_word(false, 0), &l.tx[0]) - defaults.n_cwquery_s;
+      CPPUNIT_ASSERT(4 * n_query < n_default);
+
+      l.send(l.waveforms.emit_settle(&l.tx[0]));
+      l.send(l.waveforms.emit_query(query_word(false, 0), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.population.stats().n_reply_slots);
+      CPPUNIT_ASSERT_EQUAL(1L, l.n_rn16(SLOT_SINGLE));
+
+      l.send(l.waveforms.emit_ack(l.engine.last_rn16().field(0, 16), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.engine.stats().n_epc_correct);
+      CPPUNIT_ASSERT(l.engine.last_epc() == l.population.epc(0));
+
+      // QueryRep: the tag is now in inventoried B and stays silent
+      l.send(l.waveforms.emit_query_rep(&l.tx[0]));
+      l.send(l.waveforms.emit_query(query_word(false, 0), &l.tx[0]));
+      CPPUNIT_ASSERT_EQUAL(1L, l.population.stats().n_reply_slots);
+      CPPUNIT_ASSERT_EQUAL(0L, l.population.stats().n_crc_errors);
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
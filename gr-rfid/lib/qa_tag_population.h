@@ -0,0 +1,56 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_TAG_POPULATION_H_
+#define _QA_TAG_POPULATION_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+namespace gr {
+  namespace rfid {
+
+    class qa_tag_population : public CppUnit::TestCase
+    {
+    public:
+      CPPUNIT_TEST_SUITE(qa_tag_population);
+      CPPUNIT_TEST(t1_query_ack);
+      CPPUNIT_TEST(t2_collision);
+      CPPUNIT_TEST(t3_select);
+      CPPUNIT_TEST(t4_inventory_50_tags);
+      CPPUNIT_TEST(t5_miller);
+      CPPUNIT_TEST(t6_link_frequency);
+      CPPUNIT_TEST(t7_short_tari);
+      CPPUNIT_TEST_SUITE_END();
+
+    private:
+      void t1_query_ack();
+      void t2_collision();
+      void t3_select();
+      void t4_inventory_50_tags();
+      void t5_miller();
+      void t6_link_frequency();
+      void t7_short_tari();
+    };
+
+  } /* namespace rfid */
+} /* namespace gr */
+
+#endif /* _QA_TAG_POPULATION_H_ */
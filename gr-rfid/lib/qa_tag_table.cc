@@ -0,0 +1,118 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_tag_table.h"
+#include "tag_table.h"
+#include <cppunit/TestAssert.h>
+#include <random>
+#include <vector>
+
+namespace gr {
+  namespace rfid {
+
+    void
+    qa_tag_table::t1_reads()
+    {
+      tag_table tags(16);
+
+      // 96-bit EPCs that differ only outside their last byte
+      uint16_t a[7] = {0x3000, 0x1111, 0x2222, 0x3333, 0x4444, 0x5555, 0x6601};
+      uint16_t b[7] = {0x3000, 0x1112, 0x2222, 0x3333, 0x4444, 0x5555, 0x6601};
+      CPPUNIT_ASSERT_EQUAL(7, tag_table::pc_words(a[0]));
+      CPPUNIT_ASSERT(tags.find(a, 7) == NULL);
+
+      tags.add_read(a, 7, 100, -30, 0.5);
+      tags.add_read(b, 7, 200, -40, 1.0);
+      const tag_table::tag_record & r = tags.add_read(a, 7, 300, -31, 0.6);
+      CPPUNIT_ASSERT_EQUAL(2, tags.size());
+      CPPUNIT_ASSERT_EQUAL(2L, r.n_reads);
+      CPPUNIT_ASSERT_EQUAL((uint64_t) 100, r.first_seen_ns);
+      CPPUNIT_ASSERT_EQUAL((uint64_t) 300, r.last_seen_ns);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(-31, r.rssi, 1e-6);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(0.6, r.phase, 1e-6);
+
+      const tag_table::tag_record * rb = tags.find(b, 7);
+      CPPUNIT_ASSERT(rb != NULL);
+      CPPUNIT_ASSERT_EQUAL(1L, rb->n_reads);
+      CPPUNIT_ASSERT(&tags.record(1) == rb);
+
+      tags.clear();
+      CPPUNIT_ASSERT_EQUAL(0, tags.size());
+      CPPUNIT_ASSERT(tags.find(a, 7) == NULL);
+    }
+
+    void
+    qa_tag_table::t2_epc_length()
+    {
+      tag_table tags(16);
+
+      // 496-bit EPC (L = 31) and a 96-bit EPC with the same first words
+      uint16_t words[tag_table::MAX_WORDS];
+      words[0] = 31 << 11;
+      for (int i = 1; i < tag_table::MAX_WORDS; i++)
+        words[i] = i;
+      int n_words = tag_table::pc_words(words[0]);
+      CPPUNIT_ASSERT_EQUAL(tag_table::MAX_WORDS, n_words);
+
+      tags.add_read(words, n_words, 0, 0, 0);
+      tags.add_read(words, 7, 0, 0, 0);
+      CPPUNIT_ASSERT_EQUAL(2, tags.size());
+      CPPUNIT_ASSERT_EQUAL(tag_table::MAX_WORDS, tags.find(words, n_words)->n_words);
+      CPPUNIT_ASSERT_EQUAL(7, tags.find(words, 7)->n_words);
+      CPPUNIT_ASSERT(tags.find(words, 8) == NULL);
+
+      // Longer keys are cut at MAX_WORDS
+      std::vector<uint16_t> longer(words, words + n_words);
+      longer.push_back(0xffff);
+      CPPUNIT_ASSERT_EQUAL(2L, tags.add_read(&longer[0], longer.size(), 0, 0, 0).n_reads);
+    }
+
+    void
+    qa_tag_table::t3_many_tags()
+    {
+      // Random 96-bit EPCs, well past the initial capacity
+      const int N = 50000;
+      tag_table tags(1024);
+      std::mt19937 rng(19);
+      std::vector<uint16_t> epcs(7 * N);
+      for (int i = 0; i < N; i++)
+      {
+        epcs[7 * i] = 0x3000;
+        for (int j = 1; j < 7; j++)
+          epcs[7 * i + j] = rng();
+      }
+
+      for (int pass = 1; pass <= 2; pass++)
+        for (int i = 0; i < N; i++)
+          tags.add_read(&epcs[7 * i], 7, pass, 0, 0);
+
+      CPPUNIT_ASSERT_EQUAL(N, tags.size());
+      CPPUNIT_ASSERT(tags.capacity() >= N);
+      for (int i = 0; i < N; i++)
+      {
+        // Records stay in order of first read across growths
+        CPPUNIT_ASSERT(&tags.record(i) == tags.find(&epcs[7 * i], 7));
+        CPPUNIT_ASSERT_EQUAL(2L, tags.record(i).n_reads);
+        CPPUNIT_ASSERT_EQUAL((uint64_t) 2, tags.record(i).last_seen_ns);
+      }
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,48 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_TAG_TABLE_H_
+#define _QA_TAG_TABLE_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+namespace gr {
+  namespace rfid {
+
+    class qa_tag_table : public CppUnit::TestCase
+    {
+    public:
+      CPPUNIT_TEST_SUITE(qa_tag_table);
+      CPPUNIT_TEST(t1_reads);
+      CPPUNIT_TEST(t2_epc_length);
+      CPPUNIT_TEST(t3_many_tags);
+      CPPUNIT_TEST_SUITE_END();
+
+    private:
+      void t1_reads();
+      void t2_epc_length();
+      void t3_many_tags();
+    };
+
+  } /* namespace rfid */
+} /* namespace gr */
+
+#endif /* _QA_TAG_TABLE_H_ */
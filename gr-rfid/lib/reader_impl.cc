@@ -25,7 +25,8 @@
 #include <gnuradio/io_signature.h>
 #include "reader_impl.h"
 #include "rfid/global_vars.h"
-#include "crc_t.h"
+#include "crc.h"
+#include "tag_table.h"
 #include <sys/time.h>
 #include <iostream>
 #include <iomanip>
@@ -37,111 +38,49 @@ namespace gr {
   namespace rfid {
 
     reader::sptr
-    reader::make(int sample_rate, int dac_rate, bool select, const std::string &select_mask)
+    reader::make(session::sptr reader_session, int sample_rate, int dac_rate, bool select, const std::string &select_mask,
+                 float blf, int dr, float tari, float data1)
     {
       return gnuradio::get_initial_sptr
-        (new reader_impl(sample_rate,dac_rate,select,select_mask));
+        (new reader_impl(reader_session,sample_rate,dac_rate,select,select_mask,blf,dr,tari,data1));
     }
 
     /*
      * The private constructor
      */
-    reader_impl::reader_impl(int sample_rate, int dac_rate, bool select, const std::string &select_mask)
+    reader_impl::reader_impl(session::sptr reader_session, int sample_rate, int dac_rate, bool select, const std::string &select_mask,
+                             float blf, int dr, float tari, float data1)
       : gr::block("reader",
-              gr::io_signature::make( 1, 1, sizeof(float)),
-              gr::io_signature::make( 1, 1, sizeof(float)))
+              gr::io_signature::make( 1, 1, sizeof(uint16_t)),
+              gr::io_signature::make( 1, 1, sizeof(float))),
+              s_rate(sample_rate), d_rate(dac_rate), select(select), tag_encoding(TAG_ENCODING), announce_antenna(true), waveforms(dac_rate),
+              reader_session(reader_session), reader_state(reader_session->state()),
+              latency(reader_session->latency()), last_summary(latency_monitor::now()),
+              board(reader_session->board())
     {
 
       GR_LOG_INFO(d_logger, "Block initialized");
 
-      sample_d = 1.0/dac_rate * pow(10,6);
-
-      // Number of samples for transmitting
-
-      n_data0_s = 2 * PW_D / sample_d;
-      n_data1_s = 4 * PW_D / sample_d;
-      n_pw_s    = PW_D    / sample_d;
-      n_cw_s    = CW_D    / sample_d;
-      n_delim_s = DELIM_D / sample_d;
-      n_trcal_s = TRCAL_D / sample_d;
-
-      GR_LOG_INFO(d_logger, "Number of samples data 0 : " << n_data0_s);
-      GR_LOG_INFO(d_logger, "Number of samples data 1 : " << n_data1_s);
-      GR_LOG_INFO(d_logger, "Number of samples cw : "     << n_cw_s);
-      GR_LOG_INFO(d_logger, "Number of samples delim : "  << n_delim_s);
+      // Gate and decoder follow the link of the session from their next burst; defaults if invalid
+      link = link_timing(blf, dr != 0, tari, data1);
+      apply_link();
+      link = waveforms.get_link();
+      GR_LOG_INFO(d_logger, "BLF : " << link.blf << " Hz, TRcal : " << link.trcal_d << " us");
+      GR_LOG_INFO(d_logger, "Tari : " << link.tari_d << " us, RTcal : " << link.rtcal_d << " us");
+
+      GR_LOG_INFO(d_logger, "Number of samples data 0 : " << waveforms.n_data0_s);
+      GR_LOG_INFO(d_logger, "Number of samples data 1 : " << waveforms.n_data1_s);
+      GR_LOG_INFO(d_logger, "Number of samples cw : "     << waveforms.n_cw_s);
+      GR_LOG_INFO(d_logger, "Number of samples delim : "  << waveforms.n_delim_s);
       GR_LOG_INFO(d_logger, "Number of slots : "          << std::pow(2,FIXED_Q));
 
-      // CW waveforms of different sizes
-      n_cwquery_s   = (T1_D+T2_D+RN16_D)/sample_d;     //RN16
-      n_cwack_s     = (3*T1_D+T2_D+EPC_D)/sample_d;    //EPC   if it is longer than nominal it wont cause tags to change inventoried flag
-      n_p_down_s    = (P_DOWN_D)/sample_d;
-      n_cwselect_s  = T4_D/sample_d;                   //SELECT
-      n_cwsettle_s  = TS_D/sample_d;                   //SETTLE
-
-      p_down.resize(n_p_down_s);        // Power down samples
-      cw_query.resize(n_cwquery_s);     // Sent after query/query rep
-      cw_ack.resize(n_cwack_s);         // Sent after ack
-      cw_select.resize(n_cwselect_s);   // Sent after select
-      cw_settle.resize(n_cwsettle_s);   // Sent before first Interrogator Command (TAG wakeup time)
-
-      std::fill_n(cw_query.begin(), cw_query.size(), 1);
-      std::fill_n(cw_ack.begin(), cw_ack.size(), 1);
-      std::fill_n(cw_select.begin(), cw_select.size(), 1);
-      std::fill_n(cw_settle.begin(), cw_settle.size(), 1);
-
-      GR_LOG_INFO(d_logger, "Carrier wave after a query transmission in samples : "     << n_cwquery_s);
-      GR_LOG_INFO(d_logger, "Carrier wave after ACK transmission in samples : "        << n_cwack_s);
-      GR_LOG_INFO(d_logger, "Carrier wave after a select transmission in samples : "     << n_cwselect_s);
-      GR_LOG_INFO(d_logger, "Carrier wave before interrogator transmission in samples : "     << n_cwsettle_s);
-
-      // Construct vectors (resize() default initialization is zero)
-      data_0.resize(n_data0_s);
-      data_1.resize(n_data1_s);
-      cw.resize(n_cw_s);
-      delim.resize(n_delim_s);
-      rtcal.resize(n_data0_s + n_data1_s);
-      trcal.resize(n_trcal_s);
-
-      // Fill vectors with data
-      std::fill_n(data_0.begin(), data_0.size()/2, 1);
-      std::fill_n(data_1.begin(), 3*data_1.size()/4, 1);
-      std::fill_n(cw.begin(), cw.size(), 1);
-      std::fill_n(rtcal.begin(), rtcal.size() - n_pw_s, 1); // RTcal
-      std::fill_n(trcal.begin(), trcal.size() - n_pw_s, 1); // TRcal
-
-      // create preamble
-      preamble.insert( preamble.end(), delim.begin(), delim.end() );
-      preamble.insert( preamble.end(), data_0.begin(), data_0.end() );
-      preamble.insert( preamble.end(), rtcal.begin(), rtcal.end() );
-      preamble.insert( preamble.end(), trcal.begin(), trcal.end() );
-
-      // create framesync
-      frame_sync.insert( frame_sync.end(), delim.begin() , delim.end() );
-      frame_sync.insert( frame_sync.end(), data_0.begin(), data_0.end() );
-      frame_sync.insert( frame_sync.end(), rtcal.begin() , rtcal.end() );
-      
-      // create query rep
-      query_rep.insert( query_rep.end(), frame_sync.begin(), frame_sync.end());
-      query_rep.insert( query_rep.end(), data_0.begin(), data_0.end() );
-      query_rep.insert( query_rep.end(), data_0.begin(), data_0.end() );
-      query_rep.insert( query_rep.end(), data_0.begin(), data_0.end() );
-      query_rep.insert( query_rep.end(), data_0.begin(), data_0.end() );
-
-      // create nak
-      nak.insert( nak.end(), frame_sync.begin(), frame_sync.end());
-      nak.insert( nak.end(), data_1.begin(), data_1.end() );
-      nak.insert( nak.end(), data_1.begin(), data_1.end() );
-      nak.insert( nak.end(), data_0.begin(), data_0.end() );
-      nak.insert( nak.end(), data_0.begin(), data_0.end() );
-      nak.insert( nak.end(), data_0.begin(), data_0.end() );
-      nak.insert( nak.end(), data_0.begin(), data_0.end() );
-      nak.insert( nak.end(), data_0.begin(), data_0.end() );
-      nak.insert( nak.end(), data_0.begin(), data_0.end() );
-
-      gen_query_adjust_bits();
+      GR_LOG_INFO(d_logger, "Carrier wave after a query transmission in samples : "     << waveforms.n_cwquery_s);
+      GR_LOG_INFO(d_logger, "Carrier wave after ACK transmission in samples : "        << waveforms.n_cwack_s);
+      GR_LOG_INFO(d_logger, "Carrier wave after a select transmission in samples : "     << waveforms.n_cwselect_s);
+      GR_LOG_INFO(d_logger, "Carrier wave before interrogator transmission in samples : "     << waveforms.n_cwsettle_s);
 
       // Adam Laurie
-      gen_query_bits(select);
+      reader_state->reader_stats.max_slot_number = slots.n_slots();
       if(select)
       {
         // add mask to SELECT (empty mask selects all)
@@ -152,44 +91,20 @@ namespace gr {
           else
             mask.push_back((float) 1);
         gen_select_bits(mask);
+        waveforms.set_select(select_bits);
       }
-    }
 
-    void reader_impl::gen_query_bits(bool select)
-    {
-      query_bits.resize(0);
-      query_bits.insert(query_bits.end(), &QUERY_CODE[0], &QUERY_CODE[4]);
-      query_bits.push_back(DR);
-      query_bits.insert(query_bits.end(), &M[0], &M[2]);
-      query_bits.push_back(TREXT);
-      if(select)
-        query_bits.insert(query_bits.end(), &SEL_SL[0], &SEL_SL[2]);
-      else
-        query_bits.insert(query_bits.end(), &SEL_ALL[0], &SEL_ALL[2]);
-      query_bits.insert(query_bits.end(), &SESSION[0], &SESSION[2]);
-      query_bits.push_back(TARGET);
-    
-      query_bits.insert(query_bits.end(), &Q_VALUE[FIXED_Q][0], &Q_VALUE[FIXED_Q][4]);
-      crc_append(query_bits);
-    }
+      // Every command burst is emitted by a single call
+      set_min_noutput_items(waveforms.max_burst_size());
 
+      // The decoder reports the outcome of each slot; the block sleeps while IDLE
+      message_port_register_in(pmt::mp("events"));
+      set_msg_handler(pmt::mp("events"), boost::bind(&reader_impl::handle_event, this, _1));
 
-    void reader_impl::gen_ack_bits(const float * in)
-    {
-      ack_bits.resize(0);
-      ack_bits.insert(ack_bits.end(), &ACK_CODE[0], &ACK_CODE[2]);
-      ack_bits.insert(ack_bits.end(), &in[0], &in[16]);
-    }
-  
-    void reader_impl::gen_query_adjust_bits()
-    {
-      query_adjust_bits.resize(0);
-      query_adjust_bits.insert(query_adjust_bits.end(), &QADJ_CODE[0], &QADJ_CODE[4]);
-      query_adjust_bits.insert(query_adjust_bits.end(), &SESSION[0], &SESSION[2]);
-      query_adjust_bits.insert(query_adjust_bits.end(), &Q_UPDN[1][0], &Q_UPDN[1][3]);
+      // Port of the following bursts, also tagged "antenna" on the output stream
+      message_port_register_out(pmt::mp("antenna"));
     }
 
-
     // Adam Laurie
     void reader_impl::gen_select_bits(std::vector<float> & mask)
     {
@@ -218,34 +133,251 @@ namespace gr {
 
     }
 
+    void reader_impl::set_q_mode(int mode)
+    {
+      if (mode < Q_FIXED || mode > Q_VOGT)
+      {
+        GR_LOG_WARN(d_logger, "Q mode " << mode << " ignored: 0 fixed, 1 floating, 2 Schoute or 3 Vogt");
+        return;
+      }
+      gr::thread::scoped_lock guard(d_setlock);
+      slots.antennas().set_q_mode((Q_MODE) mode);
+    }
+
+    void reader_impl::set_q_step(float c)
+    {
+      if (!(c >= Q_STEP_MIN && c <= Q_STEP_MAX))
+      {
+        GR_LOG_WARN(d_logger, "Q step " << c << " ignored: C is 0.1 to 0.5");
+        return;
+      }
+      gr::thread::scoped_lock guard(d_setlock);
+      slots.antennas().set_q_step(c);
+    }
+
+    void reader_impl::set_tag_encoding(int m)
+    {
+      if (m != 1 && m != 2 && m != 4 && m != 8)
+      {
+        GR_LOG_WARN(d_logger, "Tag encoding " << m << " ignored: M is 1 (FM0), 2, 4 or 8 (Miller)");
+        return;
+      }
+      gr::thread::scoped_lock guard(d_setlock);
+      tag_encoding = m;
+    }
+
+    void reader_impl::set_link(float blf, int dr)
+    {
+      if (!(blf >= BLF_MIN && blf <= BLF_MAX))
+      {
+        GR_LOG_WARN(d_logger, "BLF " << blf << " Hz ignored: BLF is 40 to 640 kHz");
+        return;
+      }
+      gr::thread::scoped_lock guard(d_setlock);
+      link = link_timing(blf, dr != 0, link.tari_d, link.data1);
+    }
+
+    void reader_impl::set_pie(float tari, float data1)
+    {
+      if (!(tari >= TARI_MIN_D && tari <= TARI_MAX_D && data1 >= DATA1_MIN_T && data1 <= DATA1_MAX_T))
+      {
+        GR_LOG_WARN(d_logger, "Tari " << tari << " us with data-1 of " << data1 << " Tari ignored: Tari is 6.25 to 25 us, data-1 1.5 to 2 Tari");
+        return;
+      }
+      gr::thread::scoped_lock guard(d_setlock);
+      link = link_timing(link.blf, link.dr, tari, data1);
+    }
+
+    void reader_impl::set_antennas(int n_antennas, int dwell_rounds, float dwell_s)
+    {
+      if (n_antennas < 1 || dwell_rounds < 0 || !(dwell_s >= 0) || (n_antennas > 1 && dwell_rounds == 0 && dwell_s == 0))
+      {
+        GR_LOG_WARN(d_logger, n_antennas << " antennas with a dwell of " << dwell_rounds << " rounds / " << dwell_s
+                    << " s ignored: at least 1 antenna, and a dwell limit if there are several");
+        return;
+      }
+      // The ongoing round ends on its antenna
+      gr::thread::scoped_lock guard(d_setlock);
+      slots.set_antennas(n_antennas, dwell_rounds, dwell_s);
+    }
+
+    // BLF and Tari are set separately: TRcal / RTcal is checked once both are known, at the Query.
+    // The decimation of the receive chain is fixed when the flowgraph is built: the BLF must leave
+    // HALF_BIT_MIN_S samples per half bit at the decoder
+    void reader_impl::apply_link()
+    {
+      if (link == waveforms.get_link())
+        return;
+      float half_bit_s = s_rate / (2 * link.blf);
+      if (!link.valid() || half_bit_s < HALF_BIT_MIN_S)
+      {
+        const link_timing & current = waveforms.get_link();
+        if (link != rejected_link && half_bit_s < HALF_BIT_MIN_S)
+          GR_LOG_WARN(d_logger, "BLF " << link.blf << " Hz gives " << half_bit_s << " samples per half bit at " << s_rate
+                      << " S/s, " << HALF_BIT_MIN_S << " needed: keeping BLF " << current.blf << " Hz");
+        else if (link != rejected_link)
+          GR_LOG_WARN(d_logger, "TRcal " << link.trcal_d << " us is not 1.1 to 3 RTcal (" << link.rtcal_d
+                      << " us): keeping BLF " << current.blf << " Hz and Tari " << current.tari_d << " us");
+        rejected_link = link;
+        return;
+      }
+      waveforms.set_link(link);
+      reader_state->blf = link.blf;
+      reader_state->tari = link.tari_d;
+      reader_state->data1 = link.data1;
+      latency->set_t2(link.t2_d);
+    }
+
     void reader_impl::print_results()
     {
+      // Called from the Python thread: counters come from the snapshot
+      inventory_stats stats = board->snapshot();
+
       std::cout << "\n --------------------------" << std::endl;
-      std::cout << "| Number of queries/queryreps sent : " << reader_state->reader_stats.n_queries_sent - 1 << std::endl;
-      std::cout << "| Current Inventory round : "          << reader_state->reader_stats.cur_inventory_round << std::endl;
+      std::cout << "| Number of queries/queryreps sent : " << stats.n_queries_sent - 1 << std::endl;
+      std::cout << "| Current Inventory round : "          << stats.n_rounds + 1 << std::endl;
+      std::cout << "| Slots empty/single/collided : "      << stats.n_slots_empty << "/" << stats.n_slots_single
+                << "/" << stats.n_slots_collided << std::endl;
       std::cout << " --------------------------"            << std::endl;
 
-      std::cout << "| Correctly decoded EPC : "  <<  reader_state->reader_stats.n_epc_correct     << std::endl;
-      std::cout << "| Number of unique tags : "  <<  reader_state->reader_stats.tag_reads.size() << std::endl;
+      std::cout << "| Correctly decoded EPC : "  <<  stats.n_epc_correct     << std::endl;
+      std::cout << "| EPC CRC failure rate : "   <<  stats.crc_failure_rate  << std::endl;
+      std::cout << "| Number of unique tags : "  <<  stats.n_unique_tags     << std::endl;
+      std::cout << "| Reads per second : "       <<  stats.reads_per_s       << std::endl;
 
-      std::map<int,int>::iterator it;
+      if (stats.n_rounds > 0)
+      {
+        std::cout << "| Mean throughput per round (tags/s) : " << stats.mean_round_reads_per_s << std::endl;
+        std::cout << "| Last round throughput (tags/s) : "     << stats.last_round_reads_per_s << std::endl;
+      }
 
-      for(it = reader_state->reader_stats.tag_reads.begin(); it != reader_state->reader_stats.tag_reads.end(); it++) 
       {
-        std::cout << std::hex <<  "| Tag ID : " << it->first << "  ";
-        std::cout << "Num of reads : " << std::dec << it->second << std::endl;
+        std::lock_guard<std::mutex> guard(reader_state->reader_stats.tags_lock);
+        const tag_table & tags = *reader_state->reader_stats.tags;
+
+        // EPC words after the PC, in order of first read
+        for(int i = 0; i < tags.size(); i++)
+        {
+          const tag_table::tag_record & tag = tags.record(i);
+          std::cout << "| Tag ID : " << std::hex << std::setfill('0');
+          for(int j = 1; j < tag.n_words; j++)
+            std::cout << std::setw(4) << tag.words[j];
+          std::cout << std::setfill(' ') << "  Num of reads : " << std::dec << tag.n_reads << std::endl;
+        }
+      }
+
+      {
+        gr::thread::scoped_lock guard(d_setlock);
+        if (slots.antennas().n_antennas() > 1)
+        {
+          std::cout << " --------------------------" << std::endl;
+          std::cout << slots.antennas().summary(latency_monitor::now());
+        }
       }
 
+      std::cout << " --------------------------" << std::endl;
+      std::cout << latency->summary();
       std::cout << " --------------------------" << std::endl;
       // Adam Laurie
-      // Force re-start
-      reader_state->gen2_logic_status= START;
+      // Force re-start (the event also wakes the block up if it is IDLE)
+      pmt::pmt_t event = pmt::dict_add(pmt::make_dict(), pmt::mp("type"), pmt::mp("restart"));
+      _post(pmt::mp("events"), event);
+    }
+
+    // Message dispatch does not hold d_setlock: the setters and print_results share
+    // the Q algorithm and the antenna scheduler with the slot logic
+    void reader_impl::handle_event(pmt::pmt_t event)
+    {
+      gr::thread::scoped_lock guard(d_setlock);
+      pmt::pmt_t type = pmt::dict_ref(event, pmt::mp("type"), pmt::PMT_NIL);
+
+      if (pmt::eq(type, pmt::mp("restart")))
+      {
+        gettimeofday(&reader_state->reader_stats.round_start, NULL);
+        reader_state->reader_stats.round_start_epc = reader_state->reader_stats.n_epc_correct;
+        reader_state->gen2_logic_status = START;
+      }
+      else if (pmt::eq(type, pmt::mp("rn16")))
+      {
+        // The RN16 follows on the input stream
+        reader_state->gen2_logic_status = SEND_ACK;
+      }
+      else if (pmt::eq(type, pmt::mp("rn16_fail")))
+      {
+        end_slot(SLOT_EMPTY);
+      }
+      else if (pmt::eq(type, pmt::mp("rn16_collision")))
+      {
+        // No ACK, the slot ends here
+        end_slot(SLOT_COLLISION);
+      }
+      // A single RN16 makes the slot single, whatever the EPC outcome
+      else if (pmt::eq(type, pmt::mp("epc")) || pmt::eq(type, pmt::mp("epc_fail")))
+      {
+        if (pmt::eq(type, pmt::mp("epc")))
+          slots.antennas().count_epc();
+        end_slot(SLOT_SINGLE);
+      }
+    }
+
+    void reader_impl::end_slot(SLOT_OUTCOME outcome)
+    {
+      // QueryAdjust, QueryRep, Query or START for a new antenna (slot_logic)
+      int antenna = slots.antennas().current();
+      reader_state->gen2_logic_status = slots.end_slot(outcome, latency_monitor::now());
+      reader_state->reader_stats.cur_slot_number = slots.slot();
+      board->reader().n_slots[outcome]++;
+      if (slots.round_ended())
+        end_round(antenna);
+      board->publish_reader();
+    }
+
+    void reader_impl::end_round(int antenna)
+    {
+      READER_STATS & stats = reader_state->reader_stats;
+
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      float duration = (now.tv_sec - stats.round_start.tv_sec) + (now.tv_usec - stats.round_start.tv_usec) / 1e6;
+      int n_epc = stats.n_epc_correct - stats.round_start_epc;
+      float throughput = duration > 0 ? n_epc / duration : 0;
+
+      stats.unique_tags_round.push_back(board->snapshot().n_unique_tags);
+      stats.throughput_round.push_back(throughput);
+      board->reader().n_rounds++;
+      board->reader().sum_round_reads_per_s += throughput;
+      board->reader().last_round_reads_per_s = throughput;
+      GR_LOG_INFO(d_debug_logger, "ROUND " << stats.cur_inventory_round << " : " << n_epc << " EPC in "
+                  << slots.round_slots() << " slots, " << throughput << " tags/s, antenna " << antenna
+                  << ", next Q " << slots.q_alg().q());
+
+      if (reader_state->gen2_logic_status == START)
+      {
+        GR_LOG_INFO(d_debug_logger, "ANTENNA " << slots.antennas().current() << ", Q " << slots.q_alg().q());
+        announce_antenna = true;
+      }
+
+      stats.round_start = now;
+      stats.round_start_epc = stats.n_epc_correct;
+      stats.cur_inventory_round += 1;
+      stats.max_slot_number = slots.n_slots();
+    }
+
+    void reader_impl::count_query()
+    {
+      reader_state->reader_stats.n_queries_sent += 1;
+      board->reader().n_queries_sent++;
+      board->publish_reader();
     }
 
     void
     reader_impl::forecast (int noutput_items, gr_vector_int &ninput_items_required)
     {
-      ninput_items_required[0] = 0;
+      // Wait for an event while IDLE and for the RN16 before an ACK
+      if (reader_state->gen2_logic_status == IDLE || reader_state->gen2_logic_status == SEND_ACK)
+        ninput_items_required[0] = 1;
+      else
+        ninput_items_required[0] = 0;
     }
 
     int
@@ -255,22 +387,28 @@ namespace gr {
                        gr_vector_void_star &output_items)
     {
 
-      const float *in = (const float *) input_items[0];
+      const uint16_t *in = (const uint16_t *) input_items[0];
       float *out =  (float*) output_items[0];
-      std::vector<float> out_message; 
-      int n_output;
       int consumed = 0;
       int written = 0;
+      bool timed = false;   // command answering a tag reply
 
-      consumed = ninput_items[0];
-  
       switch (reader_state->gen2_logic_status)
       {
         case START:
           GR_LOG_INFO(d_debug_logger, "START");
 
-          memcpy(&out[written], &cw_settle[0], sizeof(float) * cw_settle.size() );
-          written += cw_settle.size();
+          // The radio switches port at the tag, before the carrier settles; the dwell starts here
+          if (announce_antenna)
+          {
+            slots.antennas().start(latency_monitor::now());
+            pmt::pmt_t port = pmt::from_long(slots.antennas().current());
+            add_item_tag(0, nitems_written(0) + written, pmt::mp("antenna"), port);
+            message_port_pub(pmt::mp("antenna"), pmt::dict_add(pmt::make_dict(), pmt::mp("antenna"), port));
+            announce_antenna = false;
+          }
+
+          written += waveforms.emit_settle(&out[written]);
           // Adam Laurie
           if(select)
             reader_state->gen2_logic_status = SEND_SELECT;
@@ -280,92 +418,57 @@ namespace gr {
 
         case POWER_DOWN:
           GR_LOG_INFO(d_debug_logger, "POWER DOWN");
-          memcpy(&out[written], &p_down[0], sizeof(float) * p_down.size() );
-          written += p_down.size();
+          written += waveforms.emit_power_down(&out[written]);
           reader_state->gen2_logic_status = START;    
           break;
 
         case SEND_NAK_QR:
           GR_LOG_INFO(d_debug_logger, "SEND NAK");
-          memcpy(&out[written], &nak[0], sizeof(float) * nak.size() );
-          written += nak.size();
-          memcpy(&out[written], &cw[0], sizeof(float) * cw.size() );
-          written+=cw.size();
+          written += waveforms.emit_nak(&out[written]);
           reader_state->gen2_logic_status = SEND_QUERY_REP;
           break;
 
         case SEND_NAK_Q:
           GR_LOG_INFO(d_debug_logger, "SEND NAK");
-          memcpy(&out[written], &nak[0], sizeof(float) * nak.size() );
-          written += nak.size();
-          memcpy(&out[written], &cw[0], sizeof(float) * cw.size() );
-          written+=cw.size();
+          written += waveforms.emit_nak(&out[written]);
           reader_state->gen2_logic_status = SEND_QUERY;
           break;
 
         // Adam Laurie
         case SEND_SELECT:
           GR_LOG_INFO(d_debug_logger, "SELECT");
-          //std::cout << "SELECT" << std::endl;
-
-          memcpy(&out[written], &frame_sync[0], sizeof(float) * frame_sync.size() );
-          written+=frame_sync.size();
-
-          for(int i = 0; i < select_bits.size(); i++)
-          {
-            if(select_bits[i] == 1)
-            {
-              memcpy(&out[written], &data_1[0], sizeof(float) * data_1.size() );
-              written+=data_1.size();
-            }
-            else
-            {
-              memcpy(&out[written], &data_0[0], sizeof(float) * data_0.size() );
-              written+=data_0.size();
-            }
-          }
 
-          // gap
-          memcpy(&out[written], &cw_select[0], sizeof(float) * cw_select.size() );
-          written += cw_select.size();
+          // select + gap
+          written += waveforms.emit_select(&out[written]);
 
           reader_state->gen2_logic_status = SEND_QUERY;
           break;
 
         case SEND_QUERY:
 
-          /*if (reader_state->reader_stats.n_queries_sent % 500 == 0)
-          {
-            std::cout << "Running " << std::endl;
-          }*/
-
           GR_LOG_INFO(d_debug_logger, "QUERY");
+          latency->stamp(STAGE_EMIT);
+          timed = true;
+
+          // Drop RN16s of previous slots
+          consumed = ninput_items[0];
           GR_LOG_INFO(d_debug_logger, "INVENTORY ROUND : " << reader_state->reader_stats.cur_inventory_round << " SLOT NUMBER : " << reader_state->reader_stats.cur_slot_number);
 
-          reader_state->reader_stats.n_queries_sent +=1;  
+          count_query();
+          // The whole round uses the link and tag encoding of its Query: gate and decoder follow the session
+          apply_link();
+          if (tag_encoding != reader_state->cycles_per_symbol)
+          {
+            reader_state->cycles_per_symbol = tag_encoding;
+            waveforms.set_cycles_per_symbol(tag_encoding);
+          }
+
           // Controls the other two blocks
           reader_state->decoder_status = DECODER_DECODE_RN16;
           reader_state->gate_status    = GATE_SEEK_RN16;
 
-          memcpy(&out[written], &preamble[0], sizeof(float) * preamble.size() );
-          written+=preamble.size();
-   
-          for(int i = 0; i < query_bits.size(); i++)
-          {
-            if(query_bits[i] == 1)
-            {
-              memcpy(&out[written], &data_1[0], sizeof(float) * data_1.size() );
-              written+=data_1.size();
-            }
-            else
-            {
-              memcpy(&out[written], &data_0[0], sizeof(float) * data_0.size() );
-              written+=data_0.size();
-            }
-          }
-          // Send CW for RN16
-          memcpy(&out[written], &cw_query[0], sizeof(float) * cw_query.size() );
-          written+=cw_query.size();
+          // Query + CW for RN16
+          written += waveforms.emit_query(query_word(select, slots.q_alg().q(), tag_encoding, waveforms.get_link().dr), &out[written]);
 
           // Return to IDLE
           reader_state->gen2_logic_status = IDLE;      
@@ -373,214 +476,83 @@ namespace gr {
 
         case SEND_ACK:
           GR_LOG_INFO(d_debug_logger, "SEND ACK");
-          if (ninput_items[0] == RN16_BITS - 1)
+          if (ninput_items[0] >= 1)
           {
+            latency->stamp(STAGE_EMIT);
+            timed = true;
             // Controls the other two blocks
             reader_state->decoder_status = DECODER_DECODE_EPC;
             reader_state->gate_status    = GATE_SEEK_EPC;
 
-            gen_ack_bits(in);
-          
-            // Send FrameSync
-            memcpy(&out[written], &frame_sync[0], sizeof(float) * frame_sync.size() );
-            written += frame_sync.size();
-
-            for(int i = 0; i < ack_bits.size(); i++)
-            {
-              if(ack_bits[i] == 1)
-              {
-                memcpy(&out[written], &data_1[0], sizeof(float) * data_1.size() );
-                written += data_1.size();
-              }
-              else  
-              {
-                memcpy(&out[written], &data_0[0], sizeof(float) * data_0.size() );
-                written += data_0.size();
-              }
-            }
-             consumed = ninput_items[0];
-            reader_state->gen2_logic_status = SEND_CW; 
-          }
-          break;
+            // ACK + CW for EPC
+            written += waveforms.emit_ack(in[0], &out[written]);
 
-        case SEND_CW:
-          GR_LOG_INFO(d_debug_logger, "SEND CW");
-          memcpy(&out[written], &cw_ack[0], sizeof(float) * cw_ack.size() );
-          written += cw_ack.size();
-          reader_state->gen2_logic_status = IDLE;      // Return to IDLE
+            consumed = 1;
+            reader_state->gen2_logic_status = IDLE;
+          }
           break;
 
         case SEND_QUERY_REP:
           GR_LOG_INFO(d_debug_logger, "SEND QUERY_REP");
+          latency->stamp(STAGE_EMIT);
+          timed = true;
+          consumed = ninput_items[0];
           GR_LOG_INFO(d_debug_logger, "INVENTORY ROUND : " << reader_state->reader_stats.cur_inventory_round << " SLOT NUMBER : " << reader_state->reader_stats.cur_slot_number);
           // Controls the other two blocks
           reader_state->decoder_status = DECODER_DECODE_RN16;
           reader_state->gate_status    = GATE_SEEK_RN16;
-          reader_state->reader_stats.n_queries_sent +=1;  
+          count_query();
 
-          memcpy(&out[written], &query_rep[0], sizeof(float) * query_rep.size() );
-          written += query_rep.size();
-
-          memcpy(&out[written], &cw_query[0], sizeof(float) * cw_query.size());
-          written+=cw_query.size();
+          // QueryRep + CW for RN16
+          written += waveforms.emit_query_rep(&out[written]);
 
           reader_state->gen2_logic_status = IDLE;    // Return to IDLE
           break;
       
         case SEND_QUERY_ADJUST:
           GR_LOG_INFO(d_debug_logger, "SEND QUERY_ADJUST");
+          latency->stamp(STAGE_EMIT);
+          timed = true;
+          consumed = ninput_items[0];
           // Controls the other two blocks
           reader_state->decoder_status = DECODER_DECODE_RN16;
           reader_state->gate_status    = GATE_SEEK_RN16;
-          reader_state->reader_stats.n_queries_sent +=1;  
+          count_query();
 
-          memcpy(&out[written], &frame_sync[0], sizeof(float) * frame_sync.size() );
-          written += frame_sync.size();
+          // QueryAdjust + CW for RN16
+          written += waveforms.emit_query_adjust(slots.q_change(), &out[written]);
 
-          for(int i = 0; i < query_adjust_bits.size(); i++)
-          {
-            if(query_adjust_bits[i] == 1)
-            {
-              memcpy(&out[written], &data_1[0], sizeof(float) * data_1.size() );
-              written+=data_1.size();
-            }
-            else
-            {
-              memcpy(&out[written], &data_0[0], sizeof(float) * data_0.size() );
-              written+=data_0.size();
-            }
-          }
-          memcpy(&out[written], &cw_query[0], sizeof(float) * cw_query.size());
-          written+=cw_query.size();
           reader_state->gen2_logic_status = IDLE;    // Return to IDLE
           break;
 
         default:
-          // IDLE
+          // IDLE: input is kept until the event that goes with it has been handled
           break;
       }
       consume_each (consumed);
-      return  written;
-    }
-
-    /* Function adapted from https://www.cgran.org/wiki/Gen2 */
-    // 5 bit CRC for QUERY
-    void reader_impl::crc_append(std::vector<float> & q)
-    {
-       int crc[] = {1,0,0,1,0};
 
-      for(int i = 0; i < 17; i++)
+      // The command leaves the block with this return
+      if (timed)
       {
-        int tmp[] = {0,0,0,0,0};
-        tmp[4] = crc[3];
-        if(crc[4] == 1)
+        uint64_t now = latency_monitor::now();
+        latency->stamp(STAGE_SINK, now);
+        if (now - last_summary >= LATENCY_SUMMARY_S * 1000000000ULL)
         {
-          if (q[i] == 1)
-          {
-            tmp[0] = 0;
-            tmp[1] = crc[0];
-            tmp[2] = crc[1];
-            tmp[3] = crc[2];
-          }
-          else
-          {
-            tmp[0] = 1;
-            tmp[1] = crc[0];
-            tmp[2] = crc[1];
-            if(crc[2] == 1)
-            {
-              tmp[3] = 0;
-            }
-            else
-            {
-              tmp[3] = 1;
-            }
-          }
+          GR_LOG_INFO(d_logger, "\n" << latency->summary());
+          last_summary = now;
         }
-        else
-        {
-          if (q[i] == 1)
-          {
-            tmp[0] = 1;
-            tmp[1] = crc[0];
-            tmp[2] = crc[1];
-            if(crc[2] == 1)
-            {
-              tmp[3] = 0;
-            }
-            else
-            {
-              tmp[3] = 1;
-            }
-          }
-          else
-          {
-            tmp[0] = 0;
-            tmp[1] = crc[0];
-            tmp[2] = crc[1];
-            tmp[3] = crc[2];
-          }
-        }
-        memcpy(crc, tmp, 5*sizeof(float));
       }
-      for (int i = 4; i >= 0; i--)
-        q.push_back((float) crc[i]);
+      return  written;
     }
 
     // Adam Laurie
     // 16 bit crc for SELECT
     // test with input of '000000000100000000010' should be 0xC797
-    // warning: This code assumes no command is less then 16 bits.
     void reader_impl::crc_16_append(std::vector<float> & q)
     {
-      int num_bytes;
-      uint16_t crc;
-      int offset= 0;
-
-      // make a copy of the input with leading 0s for byte alignment
-      // CRC algo can't use preset for non byte aligned/length bitstream so we also need to manually
-      // XOR the 1st 16 bits of the input with the preset (0xffff)
-      if(q.size() % 8)
-        offset= (8 - (q.size() % 8));
-      int *qbuf= (int *) malloc((q.size() + offset) * sizeof(int));
-      if(!qbuf)
-      {
-        std::cout << "Memory Allocation Failed" << std::endl;
-        exit(1);
-      }
-
-      for(int i= 0 ; i < offset ; i++)
-        qbuf[i]= 0x00;
-      for(int i= 0 ; i < 16 ; i++)
-        qbuf[i + offset]= (int) q[i] ^ 0x01;
-      for(int i= 16 ; i < q.size() ; i++)
-        qbuf[i + offset]= (int) q[i];
-
-      // copy to bytes
-      num_bytes= q.size() / 8;
-      if(q.size() % 8)
-        num_bytes += 1;
-      unsigned char *buf= (unsigned char*) malloc(num_bytes * sizeof(unsigned char));
-      if(!buf)
-      {
-        std::cout << "Memory Allocation Failed" << std::endl;
-        exit(1);
-      }
-      memset(buf, 0x00, num_bytes);
-      for(int i= 0 ; i < num_bytes ; i++)
-        for(int j= 0 ; j < 8 ; ++j)
-          buf[i] += (unsigned char) (qbuf[i * 8 + j]) << 7 - j;
-
-      // Create a CRC-16/EPC function but with 0x0000 preset as we've already applied it. 
-      CRC_t<16, 0x1021, 0x0000, false, false, 0xffff> crc_epc;
-
-      crc= crc_epc.get_crc(buf, num_bytes);
-
-      // push CRC bits back to source buffer
+      uint16_t crc = ~crc16::update_bits(crc16::PRESET, &q[0], q.size());
       for(int i= 15 ; i >= 0 ; i--)
-          q.push_back((float) ((crc >> i) & 0x01));
-      free(qbuf);
-      free(buf);
+        q.push_back((float) ((crc >> i) & 0x01));
     }
   } /* namespace rfid */
 } /* namespace gr */
@@ -23,31 +23,56 @@
 
 #include <rfid/reader.h>
 #include <vector>
+#include "waveform_cache.h"
+#include "link_timing.h"
+#include "slot_logic.h"
+#include "latency_monitor.h"
+#include "stats_board.h"
 #include <queue>
 #include <fstream>
+#include "rfid/global_vars.h"
 namespace gr {
   namespace rfid {
 
     class reader_impl : public reader
     {
      private:
-      int s_rate, d_rate,  n_cwquery_s,  n_cwack_s, n_cwselect_s, n_cwsettle_s, n_p_down_s;
-      float sample_d, n_data0_s, n_data1_s, n_cw_s, n_pw_s, n_delim_s, n_trcal_s;
-      std::vector<float> data_0, data_1, cw, cw_ack, cw_query, cw_select, cw_settle, delim, frame_sync, preamble, rtcal, trcal, query_bits, ack_bits, query_rep, nak, query_adjust_bits, p_down, select_bits;
-      int q_change; // 0-> increment, 1-> unchanged, 2-> decrement
-      void gen_query_adjust_bits();
-      void crc_append(std::vector<float> & q);
-      void gen_query_bits(bool select);
-      void gen_ack_bits(const float * in);
+      int s_rate, d_rate;
+      bool select;
+      std::vector<float> select_bits;
+      int tag_encoding;   // M of the next Query
+      link_timing link;   // BLF, DR and Tari of the next Query
+      link_timing rejected_link;   // last invalid combination warned about
+      slot_logic slots;             // next command, port, Q and counters per antenna
+      bool announce_antenna;        // tag the next burst with the port
+      waveform_cache waveforms;
+
+      session::sptr reader_session;
+      READER_STATE * reader_state;
+      latency_monitor * latency;
+      stats_board * board;
+      uint64_t last_summary;   // ns, latency_monitor clock
+      void apply_link();
       // Adam Laurie
       void gen_select_bits(std::vector<float> & mask);
       void crc_16_append(std::vector<float> & q);
+      void handle_event(pmt::pmt_t event);
+      void end_slot(SLOT_OUTCOME outcome);
+      void end_round(int antenna);
+      void count_query();
 
     public:
       void print_results();
-      reader_impl(int sample_rate, int dac_rate, bool select, const std::string &select_mask);
+      reader_impl(session::sptr reader_session, int sample_rate, int dac_rate, bool select, const std::string &select_mask, float blf, int dr,
+                  float tari, float data1);
       ~reader_impl();
 
+      void set_q_mode(int mode);
+      void set_q_step(float c);
+      void set_tag_encoding(int m);
+      void set_link(float blf, int dr);
+      void set_pie(float tari, float data1);
+      void set_antennas(int n_antennas, int dwell_rounds, float dwell_s);
 
       void forecast (int noutput_items, gr_vector_int &ninput_items_required);
 
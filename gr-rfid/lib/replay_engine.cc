@@ -0,0 +1,129 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <algorithm>
+#include <string.h>
+#include "replay_engine.h"
+#include "crc.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    replay_engine::replay_engine(int adc_rate, int decim, const link_timing & link)
+      : decim(decim),
+        n_samples_TAG_BIT((adc_rate / decim) / link.blf),
+        // Matched to half a tag bit, as in gate_impl (25 taps at 2 MS/s and 40 kHz)
+        matched_filter(std::max(1, int(adc_rate / link.blf / 2)), decim),
+        d_gate(WIN_SIZE_D * (adc_rate / decim) / 1e6, round(link.dc_d * (adc_rate / decim) / 1e6),
+                round(link.t1_d * (adc_rate / decim) / 1e6), round(link.pw_d * (adc_rate / decim) / 1e6)),
+        d_decoder(n_samples_TAG_BIT), expect_epc(false)
+    {
+      // Room for the longest reply, a Miller-8 EPC
+      int longest = reply_decoder::burst_samples(EPC_BITS, 8, n_samples_TAG_BIT);
+      burst.resize(longest);
+      magn_squared.resize(longest);
+      set_cycles_per_symbol(1);
+      reset();
+    }
+
+    void replay_engine::set_cycles_per_symbol(int m)
+    {
+      // Same window lengths as gate_impl
+      n_samples_RN16 = reply_decoder::burst_samples(RN16_BITS, m, n_samples_TAG_BIT);
+      n_samples_EPC  = reply_decoder::burst_samples(EPC_BITS, m, n_samples_TAG_BIT);
+      d_decoder.set_cycles_per_symbol(m);
+      if (!d_gate.is_open())
+        d_gate.expect(expect_epc ? n_samples_EPC : n_samples_RN16);
+    }
+
+    void replay_engine::reset()
+    {
+      memset(&d_stats, 0, sizeof(d_stats));
+      d_gate.reset();
+      history.assign(matched_filter.taps() - 1, gr_complex(0,0));
+      phase = 0;
+      expect_epc = false;
+      d_gate.expect(n_samples_RN16);
+    }
+
+    void replay_engine::process(const gr_complex * in, int n_items)
+    {
+      d_stats.n_samples += n_items;
+
+      // Boxcar over the last n_taps samples, one output every decim samples
+      int n_hist = matched_filter.taps() - 1;
+      history.resize(n_hist + n_items);
+      memcpy(&history[n_hist], in, sizeof(gr_complex) * n_items);
+
+      int n_out = phase < n_items ? (n_items - 1 - phase) / decim + 1 : 0;
+      filtered.resize(n_out);
+      matched_filter.filter(&history[phase], n_out, &filtered[0]);
+      // Offset of the next output in the next chunk
+      phase += n_out * decim - n_items;
+
+      memmove(&history[0], &history[n_items], sizeof(gr_complex) * n_hist);
+      history.resize(n_hist);
+
+      gate(&filtered[0], n_out);
+    }
+
+    void replay_engine::gate(const gr_complex * in, int n_items)
+    {
+      int i = 0;
+      while (i < n_items)
+      {
+        int n_out;
+        gr_complex * out = &burst[d_gate.is_open() ? d_gate.burst_size() : 0];
+        i += d_gate.process(&in[i], n_items - i, out, &magn_squared[0], n_out);
+        if (d_gate.opened())
+          d_stats.n_commands++;
+        if (d_gate.closed())
+          decode_burst();
+      }
+    }
+
+    void replay_engine::decode_burst()
+    {
+      int burst_size = d_gate.burst_size();
+      if (!expect_epc)
+      {
+        SLOT_OUTCOME outcome = d_decoder.decode_rn16(&burst[0], burst_size, RN16_bits);
+        d_stats.n_rn16[outcome]++;
+        // The reader acknowledges a single RN16 only
+        expect_epc = outcome == SLOT_SINGLE;
+      }
+      else
+      {
+        d_decoder.decode_epc(&burst[0], burst_size, &magn_squared[0], burst_size, EPC_bits);
+        d_stats.n_epc++;
+        if (crc16::check(EPC_bits.words(), epc_bits::n_bits))
+          d_stats.n_epc_correct++;
+        expect_epc = false;
+      }
+      d_gate.expect(expect_epc ? n_samples_EPC : n_samples_RN16);
+    }
+  } /* namespace rfid */
+} /* namespace gr */
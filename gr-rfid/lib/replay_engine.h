@@ -0,0 +1,99 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_REPLAY_ENGINE_H
+#define INCLUDED_RFID_REPLAY_ENGINE_H
+
+#include <rfid/api.h>
+#include <gnuradio/gr_complex.h>
+#include <vector>
+#include "boxcar_filter.h"
+#include "burst_gate.h"
+#include "reply_decoder.h"
+#include "link_timing.h"
+
+namespace gr {
+  namespace rfid {
+
+    struct replay_stats
+    {
+      long n_samples;            // ADC samples processed
+      long n_commands;           // reader commands detected by the gate
+      long n_rn16[3];            // RN16 bursts per SLOT_OUTCOME
+      long n_epc, n_epc_correct; // EPC bursts, CRC passed
+    };
+
+    /*!
+     * \brief Receive chain of the reader run open-loop over recorded ADC samples.
+     *
+     * Boxcar matched filter over half a tag bit with decimation, then the
+     * burst_gate of gate_impl and the reply decoder.
+     * Nothing is transmitted, so the burst that follows each reader command
+     * is taken to be the one the reader block would have asked for: an EPC
+     * after a single RN16, an RN16 otherwise.
+     */
+    class RFID_API replay_engine
+    {
+      public:
+        replay_engine(int adc_rate, int decim, const link_timing & link = link_timing());
+
+        // Streams ADC samples through the chain, in chunks of any size
+        void process(const gr_complex * in, int n_items);
+
+        const replay_stats & stats() const { return d_stats; }
+        const rn16_bits & last_rn16() const { return RN16_bits; }
+        const epc_bits & last_epc() const { return EPC_bits; }
+        reply_decoder & decoder() { return d_decoder; }
+
+        // Tag encoding of the replies, as set in the Query: 1 FM0, 2/4/8 Miller
+        void set_cycles_per_symbol(int m);
+
+        // Clears counters, gate and decoder state: every pass over a capture starts afresh
+        void reset();
+
+      private:
+        int decim, phase;
+        int n_samples_RN16, n_samples_EPC;
+        float n_samples_TAG_BIT;
+
+        boxcar_filter matched_filter;
+        burst_gate d_gate;
+        reply_decoder d_decoder;
+        replay_stats d_stats;
+
+        // Last n_taps - 1 ADC samples, followed by the current chunk
+        std::vector<gr_complex> history, filtered;
+
+        // Burst of the gate and what the reader would have asked for
+        bool expect_epc;
+        std::vector<gr_complex> burst;
+        std::vector<float> magn_squared;
+
+        rn16_bits RN16_bits;
+        epc_bits EPC_bits;
+
+        void gate(const gr_complex * in, int n_items);
+        void decode_burst();
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_REPLAY_ENGINE_H */
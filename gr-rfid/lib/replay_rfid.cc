@@ -0,0 +1,197 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Replays a recorded receive capture through the matched filter, gate and
+ * decoder as fast as possible, without a flowgraph or radio.
+ *
+ *   replay-rfid [-r adc_rate] [-d decim] [-n repeat] [-b blf] [-t tari] [-m cycles] <capture>
+ *
+ * The capture is fc32 ADC samples (e.g. the "source" file sink of
+ * apps/reader.py, 2 MS/s by default) or a SigMF recording (.sigmf-meta or
+ * .sigmf-data, datatype cf32_le), whose sample rate is then used. -b is
+ * the backscatter link frequency of the capture in Hz (40 kHz by default),
+ * -t the Tari of its reader commands in us (24 by default, data-1 of 2 Tari),
+ * -m the tag encoding of the captured replies: 1 FM0 (default), 2/4/8 Miller.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "replay_engine.h"
+
+using namespace gr::rfid;
+
+namespace {
+
+  const int CHUNK = 65536;
+
+  bool ends_with(const std::string & s, const std::string & suffix)
+  {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  // String or number following "key": in the SigMF global object
+  std::string sigmf_value(const std::string & meta, const std::string & key)
+  {
+    size_t pos = meta.find("\"" + key + "\"");
+    if (pos == std::string::npos)
+      return "";
+    pos = meta.find(':', pos + key.size() + 2);
+    if (pos == std::string::npos)
+      return "";
+    pos = meta.find_first_not_of(" \t\r\n\"", pos + 1);
+    size_t end = meta.find_first_of(",}\"\r\n", pos);
+    return meta.substr(pos, end - pos);
+  }
+
+  // Data file and sample rate of a SigMF recording, false if not supported
+  bool open_sigmf(const std::string & path, std::string & data_path, double & adc_rate)
+  {
+    std::string base = path.substr(0, path.rfind(".sigmf-"));
+    std::ifstream file((base + ".sigmf-meta").c_str());
+    if (!file)
+    {
+      fprintf(stderr, "cannot open %s.sigmf-meta\n", base.c_str());
+      return false;
+    }
+    std::stringstream meta;
+    meta << file.rdbuf();
+
+    std::string datatype = sigmf_value(meta.str(), "core:datatype");
+    if (datatype != "cf32_le" && datatype != "cf32")
+    {
+      fprintf(stderr, "unsupported SigMF datatype '%s' (cf32_le only)\n", datatype.c_str());
+      return false;
+    }
+    std::string rate = sigmf_value(meta.str(), "core:sample_rate");
+    if (!rate.empty())
+      adc_rate = atof(rate.c_str());
+    data_path = base + ".sigmf-data";
+    return true;
+  }
+
+  void usage()
+  {
+    fprintf(stderr, "usage: replay-rfid [-r adc_rate] [-d decim] [-n repeat] [-b blf] [-t tari] [-m cycles] <capture | recording.sigmf-meta>\n");
+  }
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+  double adc_rate = 2e6;
+  float blf = T_READER_FREQ, tari = TARI_D;
+  int decim = 5, repeat = 1, cycles = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:d:n:b:t:m:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'r': adc_rate = atof(optarg); break;
+      case 'd': decim = atoi(optarg); break;
+      case 'n': repeat = atoi(optarg); break;
+      case 'b': blf = atof(optarg); break;
+      case 't': tari = atof(optarg); break;
+      case 'm': cycles = atoi(optarg); break;
+      default: usage(); return 1;
+    }
+  }
+  if (optind >= argc || decim < 1 || repeat < 1 || blf < BLF_MIN || blf > BLF_MAX || tari < TARI_MIN_D || tari > TARI_MAX_D ||
+      (cycles != 1 && cycles != 2 && cycles != 4 && cycles != 8))
+  {
+    usage();
+    return 1;
+  }
+
+  std::string data_path = argv[optind];
+  if (ends_with(data_path, ".sigmf-meta") || ends_with(data_path, ".sigmf-data"))
+    if (!open_sigmf(argv[optind], data_path, adc_rate))
+      return 1;
+
+  // Map the whole capture, the kernel pages it in as the replay advances
+  int fd = open(data_path.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0)
+  {
+    fprintf(stderr, "cannot open %s\n", data_path.c_str());
+    return 1;
+  }
+  long n_samples = st.st_size / sizeof(gr_complex);
+  if (n_samples == 0)
+  {
+    fprintf(stderr, "%s is empty\n", data_path.c_str());
+    return 1;
+  }
+  void * map = mmap(NULL, n_samples * sizeof(gr_complex), PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED)
+  {
+    fprintf(stderr, "cannot map %s\n", data_path.c_str());
+    return 1;
+  }
+  madvise(map, n_samples * sizeof(gr_complex), MADV_SEQUENTIAL);
+  const gr_complex * samples = (const gr_complex *) map;
+
+  replay_engine engine(adc_rate, decim, link_timing(blf, DR, tari));
+  engine.set_cycles_per_symbol(cycles);
+  double seconds = 0;
+  for (int r = 0; r < repeat; r++)
+  {
+    engine.reset();
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n_samples; i += CHUNK)
+      engine.process(&samples[i], std::min((long) CHUNK, n_samples - i));
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    seconds += std::chrono::duration<double>(t1 - t0).count();
+  }
+  seconds /= repeat;
+
+  const replay_stats & s = engine.stats();
+  long n_rn16 = s.n_rn16[SLOT_EMPTY] + s.n_rn16[SLOT_SINGLE] + s.n_rn16[SLOT_COLLISION];
+  long n_bursts = n_rn16 + s.n_epc;
+
+  printf("capture            %s\n", data_path.c_str());
+  printf("samples            %ld (%.3f s at %.0f S/s)\n", n_samples, n_samples / adc_rate, adc_rate);
+  printf("replay time        %.3f s\n", seconds);
+  printf("throughput         %.2f MS/s (%.1fx real time)\n", n_samples / seconds / 1e6, n_samples / adc_rate / seconds);
+  printf("reader commands    %ld\n", s.n_commands);
+  printf("bursts             %ld (%.0f bursts/s)\n", n_bursts, n_bursts / seconds);
+  printf("rn16               %ld: %ld single, %ld empty, %ld collided\n", n_rn16,
+         s.n_rn16[SLOT_SINGLE], s.n_rn16[SLOT_EMPTY], s.n_rn16[SLOT_COLLISION]);
+  printf("epc                %ld: %ld crc ok (%.1f%%)\n", s.n_epc, s.n_epc_correct,
+         s.n_epc ? 100.0 * s.n_epc_correct / s.n_epc : 0.0);
+
+  munmap(map, n_samples * sizeof(gr_complex));
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,230 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <algorithm>
+#include "reply_decoder.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+      const int MILLER_PREAMBLE[] = {0,1,0,1,1,1};
+    }
+
+    reply_decoder::reply_decoder(float n_samples_TAG_BIT)
+      : n_samples_TAG_BIT(n_samples_TAG_BIT), d_m(1), data_offset(0), T_global(n_samples_TAG_BIT/2), h_est(0,0),
+        d_classify(true), d_snr(0), d_evm(0),
+        preamble(std::vector<float>(TAG_PREAMBLE, TAG_PREAMBLE + 2 * TAG_PREAMBLE_BITS), n_samples_TAG_BIT/2, 0,
+                 1.5 * n_samples_TAG_BIT),
+        timing_rec(n_samples_TAG_BIT)
+    {
+      // Chips of the longest reply, Miller-8
+      instants.resize(2 * 8 * std::max(RN16_BITS - 1, EPC_BITS - 1));
+      set_cycles_per_symbol(1);
+    }
+
+    void reply_decoder::set_samples_per_bit(float n_samples_TAG_BIT)
+    {
+      float window_bits = preamble.get_search_window() / this->n_samples_TAG_BIT;
+      this->n_samples_TAG_BIT = n_samples_TAG_BIT;
+      T_global = n_samples_TAG_BIT/2;
+      timing_rec = timing_recovery(n_samples_TAG_BIT, timing_rec.mode());
+      preamble.set_search_window(window_bits * n_samples_TAG_BIT);
+      set_cycles_per_symbol(d_m);
+    }
+
+    float reply_decoder::rssi_db(gr_complex h, float noise_power)
+    {
+      return 10 * std::log10(std::norm(h) / std::max(noise_power, 1e-12f));
+    }
+
+    void reply_decoder::set_cycles_per_symbol(int m)
+    {
+      d_m = m;
+      float chip = n_samples_TAG_BIT/2;
+      if (m == 1)
+      {
+        data_offset = TAG_PREAMBLE_BITS * n_samples_TAG_BIT + chip; // Shifted received waveform by n_samples_TAG_BIT/2
+        preamble.set_template(std::vector<float>(TAG_PREAMBLE, TAG_PREAMBLE + 2 * TAG_PREAMBLE_BITS), chip, data_offset);
+        return;
+      }
+
+      // Pilot of plain subcarrier, then 010111: inversion between two 0s and in the middle of a 1
+      std::vector<float> chips;
+      int level = 1;
+      bool prev_zero = false;
+      for (int j = 0; j < MILLER_PILOT_BITS + TAG_PREAMBLE_BITS; j++)
+      {
+        bool pilot = j < MILLER_PILOT_BITS;
+        bool bit = !pilot && MILLER_PREAMBLE[j - MILLER_PILOT_BITS];
+        if (!pilot && !bit && prev_zero)
+          level = -level;
+        prev_zero = !pilot && !bit;
+        for (int k = 0; k < 2 * m; k++)
+        {
+          if (bit && k == m)
+            level = -level;
+          chips.push_back((k & 1) ? -level : level);
+        }
+      }
+      data_offset = chips.size() * chip;
+      preamble.set_template(chips, chip, data_offset);
+    }
+
+    SLOT_OUTCOME reply_decoder::decode_rn16(const gr_complex * in, int size, rn16_bits & bits)
+    {
+      // Sync after matched filter (equivalent), h_est from the preamble taps
+      float RN16_index = preamble.sync(in, size, h_est);
+
+      const int n_chips = 2 * d_m * (RN16_BITS-1);
+      int number_of_half_bits = 0;
+      for (float j = RN16_index; j < size; j += n_samples_TAG_BIT/2)
+      {
+        instants[number_of_half_bits] = round(j);
+        number_of_half_bits++;
+        if (number_of_half_bits == n_chips)
+          break;
+      }
+      if (number_of_half_bits < n_chips)
+      {
+        d_snr = d_evm = 0;
+        return SLOT_EMPTY;
+      }
+
+      decide(in, rn16_bits::n_bits, bits.words());
+      return classify_rn16(in, size, RN16_index);
+    }
+
+    SLOT_OUTCOME reply_decoder::classify_rn16(const gr_complex * in, int size, float RN16_index)
+    {
+      // Data power and error from the nearest of +-h_est at the half-bit instants
+      const int n_half_bits = 2 * d_m * (RN16_BITS-1);
+      float signal = 0, error = 0;
+      for (int k = 0; k < n_half_bits; k++)
+      {
+        gr_complex y = in[(int) instants[k]];
+        float s = std::real(y * std::conj(h_est)) > 0 ? 1 : -1;
+        signal += std::norm(y);
+        error += std::norm(y - s * h_est);
+      }
+      signal /= n_half_bits;
+      error /= n_half_bits;
+
+      // Noise before the preamble and after the dummy bit, a chip away from the reply
+      float chip = n_samples_TAG_BIT/2;
+      int reply_start = RN16_index - data_offset - chip;
+      int reply_end = RN16_index + (2 * d_m * RN16_BITS + 1) * chip;
+      float noise = 0;
+      int n_noise = 0;
+      for (int i = 0; i < std::min(reply_start, size); i++, n_noise++)
+        noise += std::norm(in[i]);
+      for (int i = std::max(reply_end, 0); i < size; i++, n_noise++)
+        noise += std::norm(in[i]);
+      // Too few samples: the error is all noise as far as we can tell
+      noise = n_noise >= 4 ? noise / n_noise : error;
+      noise = std::max(noise, 1e-3f * signal);
+
+      float h_power = std::norm(h_est);
+      d_snr = noise > 0 ? (signal - noise) / noise : 0;
+      d_evm = h_power > 0 ? error / h_power : 0;
+
+      if (!d_classify)
+        return SLOT_SINGLE;
+      if (d_snr < RN16_EMPTY_SNR)
+        return SLOT_EMPTY;
+      if (error > RN16_COLLISION_ERR * noise && d_evm > RN16_COLLISION_EVM)
+        return SLOT_COLLISION;
+      return SLOT_SINGLE;
+    }
+
+    void reply_decoder::decode_epc(const gr_complex * in, int size, const float * magn_squared, int magn_size, epc_bits & bits)
+    {
+      float EPC_index = preamble.sync(in, size, h_est);
+
+      // Half-bit (chip) sampling instants
+      T_global = timing_rec.recover(magn_squared, std::min(size, magn_size), EPC_index, 2 * d_m * (EPC_BITS - 1), &instants[0]);
+
+      decide(in, epc_bits::n_bits, bits.words());
+    }
+
+    void reply_decoder::decide(const gr_complex * in, int n_bits, uint64_t * words) const
+    {
+      if (d_m == 1)
+        fm0_decide(in, n_bits, words);
+      else
+        miller_decide(in, n_bits, words);
+    }
+
+    void reply_decoder::fm0_decide(const gr_complex * in, int n_bits, uint64_t * words) const
+    {
+      // A bit is 0 if both half-bits have the polarity of the previous half-bit
+      int prev = 1;
+      uint64_t word = 0;
+      for (int j = 0; j < n_bits; j++)
+      {
+        float result = std::real((in[(int) instants[2*j]] - in[(int) instants[2*j+1]]) * std::conj(h_est));
+        int sign = result > 0 ? 1 : -1;
+        word = (word << 1) | (sign != prev);
+        prev = sign;
+
+        if ((j & 63) == 63)
+        {
+          words[j >> 6] = word;
+          word = 0;
+        }
+      }
+      if (n_bits & 63)
+        words[n_bits >> 6] = word << (64 - (n_bits & 63));
+    }
+
+    void reply_decoder::miller_decide(const gr_complex * in, int n_bits, uint64_t * words) const
+    {
+      // Chips with the subcarrier removed, projected on the channel; the subcarrier starts high on every symbol
+      const int n_chips = 2 * d_m;
+      uint64_t word = 0;
+      for (int j = 0; j < n_bits; j++)
+      {
+        const float * t = &instants[j * n_chips];
+        float first = 0, second = 0;
+        for (int k = 0; k < d_m; k++)
+        {
+          float sub = (k & 1) ? -1 : 1;
+          first += sub * std::real(in[(int) t[k]] * std::conj(h_est));
+          second += sub * std::real(in[(int) t[d_m + k]] * std::conj(h_est));
+        }
+        word = (word << 1) | (first * second < 0);
+
+        if ((j & 63) == 63)
+        {
+          words[j >> 6] = word;
+          word = 0;
+        }
+      }
+      if (n_bits & 63)
+        words[n_bits >> 6] = word << (64 - (n_bits & 63));
+    }
+  } /* namespace rfid */
+} /* namespace gr */
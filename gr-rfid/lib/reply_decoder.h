@@ -0,0 +1,126 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_REPLY_DECODER_H
+#define INCLUDED_RFID_REPLY_DECODER_H
+
+#include <rfid/api.h>
+#include <gnuradio/gr_complex.h>
+#include <vector>
+#include "preamble_sync.h"
+#include "timing_recovery.h"
+#include "packed_bits.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    // Decoded replies, dummy bit excluded
+    typedef packed_bits<RN16_BITS - 1> rn16_bits;
+    typedef packed_bits<EPC_BITS - 1> epc_bits;   // PC + EPC + CRC16
+
+    /*!
+     * \brief FM0 or Miller detection of RN16 and EPC replies delimited by the gate.
+     *
+     * Works directly on the gate output and on the magnitudes stored by the
+     * gate; all scratch buffers are allocated by the constructor, so decoding
+     * does not allocate.
+     *
+     * Samples are taken per chip: an FM0 half-bit, or half a subcarrier
+     * cycle of Miller-M (2M chips per bit), which lasts as long at the same
+     * BLF. The Miller preamble template is the whole pilot and 010111 on
+     * the subcarrier, so sync and channel estimate use every chip of it.
+     */
+    class RFID_API reply_decoder
+    {
+      public:
+        reply_decoder(float n_samples_TAG_BIT);
+
+        /*!
+         * Classifies the slot from the half-bit samples and the noise outside
+         * the reply: SLOT_EMPTY if the data power is below RN16_EMPTY_SNR or
+         * the burst ends before the last half-bit, SLOT_COLLISION if the
+         * constellation error exceeds both collision limits, SLOT_SINGLE
+         * otherwise. The bits are decoded in every case but a short burst.
+         */
+        SLOT_OUTCOME decode_rn16(const gr_complex * in, int size, rn16_bits & bits);
+
+        void decode_epc(const gr_complex * in, int size, const float * magn_squared, int magn_size, epc_bits & bits);
+
+        /*!
+         * Tag encoding of the replies: 1 FM0 (default), 2/4/8 Miller with M
+         * subcarrier cycles per symbol. Rebuilds the preamble template.
+         */
+        void set_cycles_per_symbol(int m);
+        int cycles_per_symbol() const { return d_m; }
+
+        // Reply length in FM0 bit periods at the same BLF: pilot, preamble and n_bits (dummy bit included)
+        static int reply_length(int n_bits, int m) { return (n_bits + TAG_PREAMBLE_BITS + (m > 1 ? MILLER_PILOT_BITS : 0)) * m; }
+        // Samples the gate keeps for such a reply
+        static int burst_samples(int n_bits, int m, float n_samples_TAG_BIT) { return (reply_length(n_bits, m) + 2) * n_samples_TAG_BIT; }
+
+        /*!
+         * Samples per FM0 bit after a BLF change. The preamble search window
+         * keeps its length in tag bits.
+         */
+        void set_samples_per_bit(float n_samples_TAG_BIT);
+        float samples_per_bit() const { return n_samples_TAG_BIT; }
+
+        gr_complex channel_estimate() const { return h_est; }
+        // Power of a channel estimate over the noise power of the gate, dB (RSSI of a read)
+        static float rssi_db(gr_complex h, float noise_power);
+        float half_bit_period() const { return T_global; }
+
+        // Metrics of the last RN16: data to noise power, constellation error to |h|^2
+        float snr() const { return d_snr; }
+        float evm() const { return d_evm; }
+
+        // Without classification every complete RN16 burst is SLOT_SINGLE
+        void set_classification(bool classify) { d_classify = classify; }
+
+        preamble_sync & sync() { return preamble; }
+        timing_recovery & timing() { return timing_rec; }
+
+      private:
+        float n_samples_TAG_BIT;
+        int d_m;
+        float data_offset;        // samples from the preamble start to the first data chip
+        float T_global;
+        gr_complex h_est;
+        bool d_classify;
+        float d_snr, d_evm;
+
+        preamble_sync preamble;
+        timing_recovery timing_rec;
+        std::vector<float> instants;
+
+        // detection + differential decoder (since Tag uses FM0)
+        void fm0_decide(const gr_complex * in, int n_bits, uint64_t * words) const;
+        // Miller: a bit is 1 if the two halves of the symbol have opposite phase
+        void miller_decide(const gr_complex * in, int n_bits, uint64_t * words) const;
+        void decide(const gr_complex * in, int n_bits, uint64_t * words) const;
+
+        SLOT_OUTCOME classify_rn16(const gr_complex * in, int size, float RN16_index);
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_REPLY_DECODER_H */
@@ -0,0 +1,138 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include "rfid/session.h"
+#include "rfid/global_vars.h"
+#include "latency_monitor.h"
+#include "stats_board.h"
+#include "tag_table.h"
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+      // Interval index from Python
+      LATENCY_INTERVAL latency_interval(int interval)
+      {
+        if (interval < 0 || interval >= N_LATENCY_INTERVALS)
+        {
+          std::ostringstream msg;
+          msg << "latency interval " << interval << " is not 0 to " << N_LATENCY_INTERVALS - 1;
+          throw std::out_of_range(msg.str());
+        }
+        return (LATENCY_INTERVAL) interval;
+      }
+    }
+
+    session::sptr
+    session::make()
+    {
+      return session::sptr(new session());
+    }
+
+    session::session()
+    {
+      d_state = new READER_STATE;
+      d_latency = new latency_monitor;
+      d_board = new stats_board;
+      d_state-> reader_stats.n_queries_sent = 0;
+      d_state-> reader_stats.n_epc_correct = 0;
+      d_state-> reader_stats.tags = new tag_table(TAG_TABLE_CAPACITY);
+
+      d_state-> status           = RUNNING;
+      d_state-> gen2_logic_status= START;
+      d_state-> gate_status       = GATE_SEEK_RN16;
+      d_state-> decoder_status   = DECODER_DECODE_RN16;
+      d_state-> n_samples_to_ungate = 0;
+      d_state-> burst_noise = 0;
+      d_state-> cycles_per_symbol = TAG_ENCODING;
+      d_state-> blf = T_READER_FREQ;
+      d_state-> tari = TARI_D;
+      d_state-> data1 = DATA1_T;
+
+      d_state-> reader_stats.max_slot_number = pow(2,FIXED_Q);
+
+      d_state-> reader_stats.cur_inventory_round = 1;
+      d_state-> reader_stats.cur_slot_number     = 1;
+
+      gettimeofday (&d_state-> reader_stats.start, NULL);
+      d_state-> reader_stats.round_start = d_state-> reader_stats.start;
+      d_state-> reader_stats.round_start_epc = 0;
+    }
+
+    session::~session()
+    {
+      delete d_state-> reader_stats.tags;
+      delete d_state;
+      delete d_latency;
+      delete d_board;
+    }
+
+    inventory_stats
+    session::stats() const
+    {
+      return d_board->snapshot();
+    }
+
+    std::string
+    session::latency_summary() const
+    {
+      return d_latency->summary();
+    }
+
+    float
+    session::latency_percentile(int interval, float p) const
+    {
+      return d_latency->percentile(latency_interval(interval), p);
+    }
+
+    float
+    session::latency_max(int interval) const
+    {
+      return d_latency->max(latency_interval(interval));
+    }
+
+    std::vector<int>
+    session::latency_histogram(int interval) const
+    {
+      std::vector<long> counts = d_latency->histogram(latency_interval(interval));
+      return std::vector<int>(counts.begin(), counts.end());
+    }
+
+    long
+    session::latency_slots() const
+    {
+      return d_latency->n_slots();
+    }
+
+    long
+    session::t2_violations() const
+    {
+      return d_latency->n_t2_violations();
+    }
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,78 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "slot_logic.h"
+
+namespace gr {
+  namespace rfid {
+
+    slot_logic::slot_logic()
+      : pending_antennas(0), d_q_change(Q_UNCHANGED), d_round_ended(false), d_round_slots(0), d_slot(1)
+    {
+    }
+
+    void slot_logic::set_antennas(int n_antennas, int dwell_rounds, float dwell_s)
+    {
+      pending_antennas = n_antennas;
+      pending_dwell_rounds = dwell_rounds;
+      pending_dwell_s = dwell_s;
+    }
+
+    GEN2_LOGIC_STATUS slot_logic::end_slot(SLOT_OUTCOME outcome, uint64_t t_ns)
+    {
+      d_q_change = d_antennas.q_alg().end_slot(outcome);
+      d_antennas.count_slot(outcome);
+      d_slot++;
+
+      GEN2_LOGIC_STATUS next;
+      if (d_q_change != Q_UNCHANGED)
+        next = SEND_QUERY_ADJUST;
+      else if (d_slot > n_slots())
+      {
+        d_antennas.q_alg().end_round();
+        next = SEND_QUERY;
+      }
+      else
+      {
+        d_round_ended = false;
+        return SEND_QUERY_REP;
+      }
+
+      // The round ends; a new port starts with its own Q
+      bool switched = d_antennas.end_round(t_ns);
+      if (pending_antennas > 0)
+      {
+        d_antennas.set_antennas(pending_antennas, pending_dwell_rounds, pending_dwell_s);
+        d_antennas.start(t_ns);
+        pending_antennas = 0;
+        switched = true;
+      }
+      d_round_ended = true;
+      d_round_slots = d_slot - 1;
+      d_slot = 1;
+      return switched ? START : next;
+    }
+
+  } /* namespace rfid */
+} /* namespace gr */
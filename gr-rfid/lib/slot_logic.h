@@ -0,0 +1,76 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_SLOT_LOGIC_H
+#define INCLUDED_RFID_SLOT_LOGIC_H
+
+#include <rfid/api.h>
+#include <stdint.h>
+#include "antenna_scheduler.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Slot logic of the inventory: the command that opens the next slot.
+     *
+     * A Q change ends the round with a QueryAdjust, the last of its 2^Q
+     * slots with a Query of the next Q, any other slot with a QueryRep.
+     * A round that moves the antenna scheduler to another port is followed
+     * by START: the port gets carrier settling and a Query of its own Q.
+     * Driven by reader_impl, and by the closed loops of the tests and the
+     * benchmark. Times are ns of the latency_monitor clock.
+     */
+    class RFID_API slot_logic
+    {
+      public:
+        slot_logic();
+
+        antenna_scheduler & antennas() { return d_antennas; }
+        const antenna_scheduler & antennas() const { return d_antennas; }
+        q_algorithm & q_alg() { return d_antennas.q_alg(); }
+        const q_algorithm & q_alg() const { return d_antennas.q_alg(); }
+
+        // Ports of the rounds after the current one
+        void set_antennas(int n_antennas, int dwell_rounds, float dwell_s);
+
+        // SEND_QUERY_REP, SEND_QUERY_ADJUST, SEND_QUERY or START
+        GEN2_LOGIC_STATUS end_slot(SLOT_OUTCOME outcome, uint64_t t_ns);
+
+        Q_UPDATE q_change() const { return d_q_change; }     // of the next QueryAdjust
+        bool round_ended() const { return d_round_ended; }   // by the last end_slot
+        int round_slots() const { return d_round_slots; }    // slots of the last round
+        int slot() const { return d_slot; }                  // 1 to n_slots()
+        int n_slots() const { return 1 << q_alg().q(); }
+
+      private:
+        antenna_scheduler d_antennas;
+        int pending_antennas, pending_dwell_rounds;   // 0 antennas if none
+        float pending_dwell_s;
+        Q_UPDATE d_q_change;
+        bool d_round_ended;
+        int d_round_slots, d_slot;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_SLOT_LOGIC_H */
@@ -0,0 +1,110 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <string.h>
+#include "stats_board.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    static uint64_t now_ns()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    stats_board::stats_board()
+      : start_ns(now_ns()), decoder_seq(0), reader_seq(0), retries(0)
+    {
+      memset(&decoder_local, 0, sizeof(decoder_local));
+      memset(&decoder_shared, 0, sizeof(decoder_shared));
+      memset(&reader_local, 0, sizeof(reader_local));
+      memset(&reader_shared, 0, sizeof(reader_shared));
+    }
+
+    template <typename T>
+    void stats_board::publish(std::atomic<uint32_t> & seq, const T & local, T & shared)
+    {
+      uint32_t s = seq.load(std::memory_order_relaxed);
+      seq.store(s + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      memcpy(&shared, &local, sizeof(T));
+      seq.store(s + 2, std::memory_order_release);
+    }
+
+    template <typename T>
+    T stats_board::read(const std::atomic<uint32_t> & seq, const T & shared) const
+    {
+      T copy;
+      while (true)
+      {
+        uint32_t s = seq.load(std::memory_order_acquire);
+        if ((s & 1) == 0)
+        {
+          memcpy(&copy, &shared, sizeof(T));
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (seq.load(std::memory_order_relaxed) == s)
+            return copy;
+        }
+        retries.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    void stats_board::publish_decoder()
+    {
+      publish(decoder_seq, decoder_local, decoder_shared);
+    }
+
+    void stats_board::publish_reader()
+    {
+      publish(reader_seq, reader_local, reader_shared);
+    }
+
+    inventory_stats stats_board::snapshot() const
+    {
+      decoder_counters d = read(decoder_seq, decoder_shared);
+      reader_counters r = read(reader_seq, reader_shared);
+
+      inventory_stats s;
+      s.elapsed_s = (now_ns() - start_ns) / 1e9;
+      s.n_queries_sent = r.n_queries_sent;
+      s.n_rounds = r.n_rounds;
+      s.n_slots_empty = r.n_slots[SLOT_EMPTY];
+      s.n_slots_single = r.n_slots[SLOT_SINGLE];
+      s.n_slots_collided = r.n_slots[SLOT_COLLISION];
+      s.n_epc_correct = d.n_epc_correct;
+      s.n_epc_crc_fail = d.n_epc_crc_fail;
+      s.n_unique_tags = d.n_unique_tags;
+
+      long n_epc = d.n_epc_correct + d.n_epc_crc_fail;
+      s.crc_failure_rate = n_epc > 0 ? (double) d.n_epc_crc_fail / n_epc : 0;
+      s.reads_per_s = s.elapsed_s > 0 ? d.n_epc_correct / s.elapsed_s : 0;
+      s.mean_round_reads_per_s = r.n_rounds > 0 ? r.sum_round_reads_per_s / r.n_rounds : 0;
+      s.last_round_reads_per_s = r.last_round_reads_per_s;
+      return s;
+    }
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,94 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_STATS_BOARD_H
+#define INCLUDED_RFID_STATS_BOARD_H
+
+#include <rfid/api.h>
+#include <rfid/session.h>
+#include <atomic>
+#include <stdint.h>
+
+namespace gr {
+  namespace rfid {
+
+    // Counters owned by the tag_decoder thread
+    struct decoder_counters
+    {
+      long n_epc_correct;
+      long n_epc_crc_fail;
+      long n_unique_tags;
+    };
+
+    // Counters owned by the reader thread
+    struct reader_counters
+    {
+      long n_queries_sent;
+      long n_rounds;                       // completed rounds
+      long n_slots[3];                     // by SLOT_OUTCOME
+      double sum_round_reads_per_s;
+      double last_round_reads_per_s;
+    };
+
+    /*!
+     * \brief Inventory counters of a reader chain, readable from any thread.
+     *
+     * Each section has a single writer thread, which updates its private
+     * copy and then publishes it under a sequence number: odd while the
+     * copy is written, even once it is complete. snapshot() copies both
+     * sections and retries a section that changed meanwhile, so polling
+     * never blocks the decode threads and always sees a consistent state
+     * of each section.
+     */
+    class RFID_API stats_board
+    {
+      public:
+        stats_board();
+
+        // Writer side: update the private copy, then publish it
+        decoder_counters & decoder() { return decoder_local; }
+        void publish_decoder();
+        reader_counters & reader() { return reader_local; }
+        void publish_reader();
+
+        inventory_stats snapshot() const;
+
+        // Number of section reads that raced a writer and were retried
+        long n_retries() const { return retries.load(std::memory_order_relaxed); }
+
+      private:
+        uint64_t start_ns;
+
+        decoder_counters decoder_local, decoder_shared;
+        std::atomic<uint32_t> decoder_seq;
+        reader_counters reader_local, reader_shared;
+        std::atomic<uint32_t> reader_seq;
+        mutable std::atomic<long> retries;
+
+        template <typename T>
+        static void publish(std::atomic<uint32_t> & seq, const T & local, T & shared);
+        template <typename T>
+        T read(const std::atomic<uint32_t> & seq, const T & shared) const;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_STATS_BOARD_H */
@@ -31,38 +31,62 @@
 #include <sstream>
 
 #include <sys/time.h>
+#include <chrono>
+#include <algorithm>
 #include "tag_decoder_impl.h"
+#include "crc.h"
+#include "tag_table.h"
 
 namespace gr {
   namespace rfid {
 
     tag_decoder::sptr
-    tag_decoder::make(int sample_rate)
+    tag_decoder::make(session::sptr reader_session, int sample_rate)
     {
 
       std::vector<int> output_sizes;
-      output_sizes.push_back(sizeof(float));
+      output_sizes.push_back(sizeof(uint16_t));
       output_sizes.push_back(sizeof(gr_complex));
 
       return gnuradio::get_initial_sptr
-        (new tag_decoder_impl(sample_rate,output_sizes));
+        (new tag_decoder_impl(reader_session,sample_rate,output_sizes));
     }
 
     /*
      * The private constructor
      */
-    tag_decoder_impl::tag_decoder_impl(int sample_rate, std::vector<int> output_sizes)
+    tag_decoder_impl::tag_decoder_impl(session::sptr reader_session, int sample_rate, std::vector<int> output_sizes)
       : gr::block("tag_decoder",
               gr::io_signature::make(1, 1, sizeof(gr_complex)),
               gr::io_signature::makev(2, 2, output_sizes )),
-              s_rate(sample_rate)
+              s_rate(sample_rate), blf(T_READER_FREQ), n_samples_TAG_BIT(TAG_BIT_D * sample_rate / pow(10,6)),
+              decoder(n_samples_TAG_BIT),
+              reader_session(reader_session), reader_state(reader_session->state()),
+              latency(reader_session->latency()), board(reader_session->board())
     {
-
-
-      char_bits = (char *) malloc( sizeof(char) * 128);
-
-      n_samples_TAG_BIT = TAG_BIT_D * s_rate / pow(10,6);      
       GR_LOG_INFO(d_logger, "Number of samples of Tag bit : "<< n_samples_TAG_BIT);
+
+      // Interned once, looked up for every burst
+      burst_end_key = pmt::mp("burst_end");
+      events_port = pmt::mp("events");
+      type_key = pmt::mp("type");
+      offset_key = pmt::mp("offset");
+      rn16_event = pmt::mp("rn16");
+      rn16_fail_event = pmt::mp("rn16_fail");
+      rn16_collision_event = pmt::mp("rn16_collision");
+      epc_event = pmt::mp("epc");
+      epc_fail_event = pmt::mp("epc_fail");
+      reads_port = pmt::mp("reads");
+      epc_key = pmt::mp("epc");
+      rssi_key = pmt::mp("rssi");
+      phase_key = pmt::mp("phase");
+      time_key = pmt::mp("time");
+
+      // Slot outcomes (RN16/EPC decoded or failed) are reported to the reader
+      message_port_register_out(events_port);
+      // Every correct EPC, with its RSSI and phase
+      message_port_register_out(reads_port);
+      set_tag_propagation_policy(TPP_DONT);
     }
 
     /*
@@ -79,124 +103,66 @@ namespace gr {
         ninput_items_required[0] = noutput_items;
     }
 
-    int tag_decoder_impl::tag_sync(const gr_complex * in , int size)
+    void tag_decoder_impl::set_sync_window(float tag_bits)
     {
-      int max_index = 0;
-      float max = 0,corr;
-      gr_complex corr2;
-      
-      // Do not have to check entire vector (not optimal)
-      for (int i=0; i < 1.5 * n_samples_TAG_BIT ; i++)
+      if (!(tag_bits > 0 && tag_bits <= RN16_BITS))
       {
-        corr2 = gr_complex(0,0);
-        corr = 0;
-        // sync after matched filter (equivalent)
-        for (int j = 0; j < 2 * TAG_PREAMBLE_BITS; j ++)
-        {
-          corr2 = corr2 + in[ (int) (i+j*n_samples_TAG_BIT/2) ] * gr_complex(TAG_PREAMBLE[j],0);
-        }
-        corr = std::norm(corr2);
-        if (corr > max)
-        {
-          max = corr;
-          max_index = i;
-        }
-      }  
-
-       // Preamble ({1,1,-1,1,-1,-1,1,-1,-1,-1,1,1} 1 2 4 7 11 12)) 
-      h_est = (in[max_index] + in[ (int) (max_index + n_samples_TAG_BIT/2) ] + in[ (int) (max_index + 3*n_samples_TAG_BIT/2) ] + in[ (int) (max_index + 6*n_samples_TAG_BIT/2)] + in[(int) (max_index + 10*n_samples_TAG_BIT/2) ] + in[ (int) (max_index + 11*n_samples_TAG_BIT/2)])/std::complex<float>(6,0);  
-
-
-      // Shifted received waveform by n_samples_TAG_BIT/2
-      max_index = max_index + TAG_PREAMBLE_BITS * n_samples_TAG_BIT + n_samples_TAG_BIT/2; 
-      return max_index;  
+        GR_LOG_WARN(d_logger, "Sync window of " << tag_bits << " tag bits ignored: 0 to " << RN16_BITS << " tag bits");
+        return;
+      }
+      gr::thread::scoped_lock guard(d_setlock);
+      decoder.sync().set_search_window(tag_bits * n_samples_TAG_BIT);
     }
 
+    void tag_decoder_impl::set_sync_interpolation(bool interpolate)
+    {
+      gr::thread::scoped_lock guard(d_setlock);
+      decoder.sync().set_interpolation(interpolate);
+    }
 
-
-
-    std::vector<float>  tag_decoder_impl::tag_detection_RN16(std::vector<gr_complex> & RN16_samples_complex)
+    void tag_decoder_impl::set_timing_mode(int mode)
     {
-      // detection + differential decoder (since Tag uses FM0)
-      std::vector<float> tag_bits,dist;
-      float result;
-      int prev = 1,index_T=0;
-      
-      for (int j = 0; j < RN16_samples_complex.size()/2 ; j ++ )
+      if (mode < TIMING_GRID_SEARCH || mode > TIMING_EARLY_LATE)
       {
-        result = std::real( (RN16_samples_complex[2*j] - RN16_samples_complex[2*j+1])*std::conj(h_est)); 
-  
-        if (result>0){
-          if (prev == 1)
-            tag_bits.push_back(0);
-          else
-            tag_bits.push_back(1);      
-          prev = 1;      
-        }
-        else
-        { 
-          if (prev == -1)
-            tag_bits.push_back(0);
-          else
-            tag_bits.push_back(1);      
-          prev = -1;    
-        }
+        GR_LOG_WARN(d_logger, "Timing mode " << mode << " ignored: 0 grid search, 1 coarse-to-fine or 2 early-late");
+        return;
       }
-      return tag_bits;
+      gr::thread::scoped_lock guard(d_setlock);
+      decoder.timing().set_mode((TIMING_MODE) mode);
     }
 
-
-    std::vector<float>  tag_decoder_impl::tag_detection_EPC(std::vector<gr_complex> & EPC_samples_complex, int index)
+    void tag_decoder_impl::set_collision_detection(bool detect)
     {
-      std::vector<float> tag_bits,dist;
-      float result=0;
-      int prev = 1;
-      
-      int number_steps = 20;
-      float min_val = n_samples_TAG_BIT/2.0 -  n_samples_TAG_BIT/2.0/100, max_val = n_samples_TAG_BIT/2.0 +  n_samples_TAG_BIT/2.0/100;
-
-      std::vector<float> energy;
-
-      energy.resize(number_steps);
-      for (int t = 0; t <number_steps; t++)
-      {  
-        for (int i =0; i <256; i++)
-        {
-          energy[t]+= reader_state->magn_squared_samples[(int) (i * (min_val + t*(max_val-min_val)/(number_steps-1)) + index)];
-        }
+      gr::thread::scoped_lock guard(d_setlock);
+      decoder.set_classification(detect);
+    }
 
-      }
-      int index_T = std::distance(energy.begin(), std::max_element(energy.begin(), energy.end()));
-      float T =  min_val + index_T*(max_val-min_val)/(number_steps-1);
+    void tag_decoder_impl::post_event(const pmt::pmt_t & type, uint64_t burst_end_offset)
+    {
+      pmt::pmt_t event = pmt::make_dict();
+      event = pmt::dict_add(event, type_key, type);
+      event = pmt::dict_add(event, offset_key, pmt::from_uint64(burst_end_offset));
+      latency->stamp(STAGE_DECODED);
+      message_port_pub(events_port, event);
+    }
 
-      // T estimated
-      T_global = T;
-  
-      for (int j = 0; j < 128 ; j ++ )
+    void tag_decoder_impl::post_read(const uint16_t * words, int n_words, float rssi, float phase, uint64_t t_ns)
+    {
+      uint8_t bytes[2 * tag_table::MAX_WORDS];
+      n_words = std::min(n_words, tag_table::MAX_WORDS);
+      for (int i = 0; i < n_words; i++)
       {
-        result = std::real((EPC_samples_complex[ (int) (j*(2*T) + index) ] - EPC_samples_complex[ (int) (j*2*T + T + index) ])*std::conj(h_est) ); 
-
-        
-         if (result>0){
-          if (prev == 1)
-            tag_bits.push_back(0);
-          else
-            tag_bits.push_back(1);      
-          prev = 1;      
-        }
-        else
-        { 
-          if (prev == -1)
-            tag_bits.push_back(0);
-          else
-            tag_bits.push_back(1);      
-          prev = -1;    
-        }
+        bytes[2 * i] = words[i] >> 8;
+        bytes[2 * i + 1] = words[i] & 0xff;
       }
-      return tag_bits;
+      pmt::pmt_t read = pmt::make_dict();
+      read = pmt::dict_add(read, epc_key, pmt::init_u8vector(2 * n_words, bytes));
+      read = pmt::dict_add(read, rssi_key, pmt::from_double(rssi));
+      read = pmt::dict_add(read, phase_key, pmt::from_double(phase));
+      read = pmt::dict_add(read, time_key, pmt::from_uint64(t_ns));
+      message_port_pub(reads_port, read);
     }
 
-
     int
     tag_decoder_impl::general_work (int noutput_items,
                        gr_vector_int &ninput_items,
@@ -206,264 +172,114 @@ namespace gr {
 
 
       const gr_complex *in = (const  gr_complex *) input_items[0];
-      float *out = (float *) output_items[0];
-      gr_complex *out_2 = (gr_complex *) output_items[1]; // for debugging
-      
-      int written_sync =0;
-      int written = 0, consumed = 0;
-      int RN16_index , EPC_index;
+      uint16_t *out = (uint16_t *) output_items[0];
 
-      std::vector<float> RN16_samples_real;
-      std::vector<float> EPC_samples_real;
+      int consumed = 0;
 
-      std::vector<gr_complex> RN16_samples_complex;
-      std::vector<gr_complex> EPC_samples_complex;
-
-      std::vector<float> RN16_bits;
-      int number_of_half_bits = 0;
-
-      std::vector<float> EPC_bits;    
-      // Processing only after n_samples_to_ungate are available and we need to decode an RN16
-      if (reader_state->decoder_status == DECODER_DECODE_RN16 && ninput_items[0] >= reader_state->n_samples_to_ungate)
+      // Processing only after the gate has marked the end of the burst
+      get_tags_in_range(burst_end, 0, nitems_read(0), nitems_read(0) + ninput_items[0], burst_end_key);
+      if (burst_end.empty())
       {
-        RN16_index = tag_sync(in,ninput_items[0]);
-
-        /*
-        for (int j = 0; j < ninput_items[0]; j ++ )
-        {
-          out_2[written_sync] = in[j];
-           written_sync ++;
-        }    
-        produce(1,written_sync);
-        */
+        consume_each(0);
+        return WORK_CALLED_PRODUCE;
+      }
+      int burst_size = burst_end[0].offset - nitems_read(0) + 1;
+      uint64_t burst_end_offset = pmt::to_uint64(burst_end[0].value);
 
+      // BLF and tag encoding of the round, set by the reader before its Query
+      if (reader_state->blf != blf)
+      {
+        blf = reader_state->blf;
+        n_samples_TAG_BIT = s_rate / blf;
+        decoder.set_samples_per_bit(n_samples_TAG_BIT);
+      }
+      if (decoder.cycles_per_symbol() != reader_state->cycles_per_symbol)
+        decoder.set_cycles_per_symbol(reader_state->cycles_per_symbol);
 
-        for (float j = RN16_index; j < ninput_items[0]; j += n_samples_TAG_BIT/2 )
+      if (reader_state->decoder_status == DECODER_DECODE_RN16)
+      {
+        // RN16 is passed to the next block for the creation of ACK message,
+        // collided slots go straight to the next slot without ACK
+        SLOT_OUTCOME outcome = decoder.decode_rn16(in, burst_size, RN16_bits);
+        if (outcome == SLOT_SINGLE)
         {
-          number_of_half_bits++;
-          int k = round(j);
-          RN16_samples_complex.push_back(in[k]);
-
-          //out_2[written_sync] = in[j];
-           //written_sync ++;
-
-          if (number_of_half_bits == 2*(RN16_BITS-1))
-          {
-            //out_2[written_sync] = h_est;
-             //written_sync ++;  
-            //produce(1,written_sync);        
-            break;
-          }
-        }    
-
-        // RN16 bits are passed to the next block for the creation of ACK message
-        if (number_of_half_bits == 2*(RN16_BITS-1))
-        {  
           GR_LOG_INFO(d_debug_logger, "RN16 DECODED");
-          RN16_bits  = tag_detection_RN16(RN16_samples_complex);
-
-          for(int bit=0; bit<RN16_bits.size(); bit++)
-          {
-            out[written] =  RN16_bits[bit];
-            written ++;
-          }
-          produce(0,written);
-          reader_state->gen2_logic_status = SEND_ACK;
-        }
-        else
-        {  
-          reader_state->reader_stats.cur_slot_number++;
-          if(reader_state->reader_stats.cur_slot_number > reader_state->reader_stats.max_slot_number)
-          {
-            reader_state->reader_stats.cur_slot_number = 1;
-            reader_state->reader_stats.unique_tags_round.push_back(reader_state->reader_stats.tag_reads.size());
-
-            reader_state->reader_stats.cur_inventory_round += 1;
-    
-            //if (P_DOWN == true)
-            //  reader_state->gen2_logic_status = POWER_DOWN;
-            //else
-              reader_state->gen2_logic_status = SEND_QUERY;
-          }
-          else
-          {
-            reader_state->gen2_logic_status = SEND_QUERY_REP;
-          }
+          out[0] = RN16_bits.field(0, 16);
+          produce(0, 1);
+          post_event(rn16_event, burst_end_offset);
         }
-        consumed = reader_state->n_samples_to_ungate;
-      }
-      else if (reader_state->decoder_status == DECODER_DECODE_EPC && ninput_items[0] >= reader_state->n_samples_to_ungate )
-      {  
-
-        //After EPC message send a query rep or query
-        reader_state->reader_stats.cur_slot_number++;
-        
-        
-        EPC_index = tag_sync(in,ninput_items[0]);
-
-        for (int j = 0; j < ninput_items[0]; j++ )
+        else if (outcome == SLOT_COLLISION)
         {
-          EPC_samples_complex.push_back(in[j]);
+          GR_LOG_INFO(d_debug_logger, "RN16 COLLISION");
+          post_event(rn16_collision_event, burst_end_offset);
         }
-
-        /*
-        for (int j = 0; j < ninput_items[0] ; j ++ )
+        else
         {
-          out_2[written_sync] = in[j];
-           written_sync ++;          
+          post_event(rn16_fail_event, burst_end_offset);
         }
-        produce(1,written_sync);
-        */
-
-        EPC_bits   = tag_detection_EPC(EPC_samples_complex,EPC_index);
+        consumed = burst_size;
+      }
+      else if (reader_state->decoder_status == DECODER_DECODE_EPC)
+      {
+        decoder.decode_epc(in, burst_size, &reader_state->magn_squared_samples[0],
+                           reader_state->magn_squared_samples.size(), EPC_bits);
 
-        
-        if (EPC_bits.size() == EPC_BITS - 1)
+        if(crc16::check(EPC_bits.words(), epc_bits::n_bits))
         {
-          // float to char -> use Buettner's function
-          for (int i =0; i < 128; i ++)
+          reader_state->reader_stats.n_epc_correct+=1;
+
+          GR_LOG_INFO(d_debug_logger, "EPC CORRECTLY DECODED");
+          // Adam Laurie
+          // show full 96 bit ID
+          // first 2 bytes are not part of EPC
+          std::cout << "+ " << std::hex << std::setfill('0');
+          for(int j = 2 ; j < 14 ; ++j)
           {
-            if (EPC_bits[i] == 0)
-              char_bits[i] = '0';
-            else
-              char_bits[i] = '1';
+            std::cout << std::setw(2) << (unsigned int) EPC_bits.byte(j);
+            if(j < 13)
+              std::cout << "-";
           }
-          if(check_crc(char_bits,128) == 1)
+          std::cout << std::dec << " +" << std::flush;
+
+          // Count the read under the full PC + EPC, as long as the PC announces it
+          const int n_decoded_words = epc_bits::n_bits / 16 - 1;   // CRC excluded
+          uint16_t words[n_decoded_words];
+          for(int j = 0; j < n_decoded_words; j++)
+            words[j] = EPC_bits.field(16 * j, 16);
+          int n_words = std::min(tag_table::pc_words(words[0]), n_decoded_words);
+
+          // Backscatter power of the preamble channel estimate over the noise before the reply
+          gr_complex h = decoder.channel_estimate();
+          float rssi = reply_decoder::rssi_db(h, reader_state->burst_noise);
+          float phase = std::arg(h);
+          uint64_t t_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
           {
-
-            if(reader_state->reader_stats.cur_slot_number > reader_state->reader_stats.max_slot_number)
-            {
-              reader_state->reader_stats.cur_slot_number = 1;
-              reader_state->reader_stats.unique_tags_round.push_back(reader_state->reader_stats.tag_reads.size());
-        
-              reader_state->reader_stats.cur_inventory_round+=1;
-              //if (P_DOWN == true)
-              //  reader_state->gen2_logic_status = POWER_DOWN;
-              //else
-                reader_state->gen2_logic_status = SEND_QUERY;
-            }
-            else
-            {
-              reader_state->gen2_logic_status = SEND_QUERY_REP;
-            }
-
-            reader_state->reader_stats.n_epc_correct+=1;
-
-            int result = 0;
-            for(int i = 0 ; i < 8 ; ++i)
-            {
-              result += std::pow(2,7-i) * EPC_bits[104+i] ;
-            }
-            GR_LOG_INFO(d_debug_logger, "EPC CORRECTLY DECODED, TAG ID : " << result);
-            // Adam Laurie
-            // show full 96 bit ID
-            // first 2 bytes are not part of EPC
-            std::cout << "+ ";
-            unsigned int id0;
-            for(int j = 2 ; j < 14 ; ++j)
-              {
-              id0= 0;
-              for(int i = 0 ; i < 8 ; ++i)
-                id0 += std::pow(2,7-i) * EPC_bits[8 * j + i] ;
-              std::cout << std::hex << std::setw(2) << std::setfill('0') << id0;
-              if(j < 13)
-                std::cout << "-";
-              }
-            std::cout << std::dec << " +" << std::flush;
-
-            // Save part of Tag's EPC message (EPC[104:111] in decimal) + number of reads
-            std::map<int,int>::iterator it = reader_state->reader_stats.tag_reads.find(result);
-            if ( it != reader_state->reader_stats.tag_reads.end())
-            {
-              it->second ++;
-            }
-            else
-            {
-              reader_state->reader_stats.tag_reads[result]=1;
-            }
-          }
-          else
-          {     
-
-            if(reader_state->reader_stats.cur_slot_number > reader_state->reader_stats.max_slot_number)
-            {
-              reader_state->reader_stats.cur_slot_number = 1;
-              reader_state->reader_stats.cur_inventory_round+=1;
-              //if (P_DOWN == true)
-              //  reader_state->gen2_logic_status = POWER_DOWN;
-              //else
-              //  reader_state->gen2_logic_status = SEND_NAK_Q;
-                reader_state->gen2_logic_status = SEND_QUERY;
-            }
-            else
-            {
-                //reader_state->gen2_logic_status = SEND_NAK_QR;
-                reader_state->gen2_logic_status = SEND_QUERY_REP;
-            }
-
-            
-            GR_LOG_INFO(d_debug_logger, "EPC FAIL TO DECODE");  
-            // Adam Laurie
-            std::cout << "!";
+            std::lock_guard<std::mutex> guard(reader_state->reader_stats.tags_lock);
+            const tag_table::tag_record & tag = reader_state->reader_stats.tags->add_read(
+                words, n_words, t_ns, rssi, phase);
+            if (tag.n_reads == 1)
+              board->decoder().n_unique_tags++;
           }
+          post_read(words, n_words, rssi, phase, t_ns);
+          board->decoder().n_epc_correct++;
+          board->publish_decoder();
+          post_event(epc_event, burst_end_offset);
         }
         else
         {
-          GR_LOG_EMERG(d_debug_logger, "CHECK ME");  
+          GR_LOG_INFO(d_debug_logger, "EPC FAIL TO DECODE");
+          // Adam Laurie
+          std::cout << "!";
+          board->decoder().n_epc_crc_fail++;
+          board->publish_decoder();
+          post_event(epc_fail_event, burst_end_offset);
         }
-        consumed = reader_state->n_samples_to_ungate;
+        consumed = burst_size;
       }
       consume_each(consumed);
       return WORK_CALLED_PRODUCE;
     }
-
-
-    /* Function adapted from https://www.cgran.org/wiki/Gen2 */
-    int tag_decoder_impl::check_crc(char * bits, int num_bits)
-    {
-      register unsigned short i, j;
-      register unsigned short crc_16, rcvd_crc;
-      unsigned char * data;
-      int num_bytes = num_bits / 8;
-      data = (unsigned char* )malloc(num_bytes );
-      int mask;
-
-      for(i = 0; i < num_bytes; i++)
-      {
-        mask = 0x80;
-        data[i] = 0;
-        for(j = 0; j < 8; j++)
-        {
-          if (bits[(i * 8) + j] == '1'){
-          data[i] = data[i] | mask;
-        }
-        mask = mask >> 1;
-        }
-      }
-      rcvd_crc = (data[num_bytes - 2] << 8) + data[num_bytes -1];
-
-      crc_16 = 0xFFFF; 
-      for (i=0; i < num_bytes - 2; i++)
-      {
-        crc_16^=data[i] << 8;
-        for (j=0;j<8;j++)
-        {
-          if (crc_16&0x8000)
-          {
-            crc_16 <<= 1;
-            crc_16 ^= 0x1021;
-          }
-          else
-            crc_16 <<= 1;
-        }
-      }
-      crc_16 = ~crc_16;
-
-      if(rcvd_crc != crc_16)
-        return -1;
-      else
-        return 1;
-    }
   } /* namespace rfid */
 } /* namespace gr */
 
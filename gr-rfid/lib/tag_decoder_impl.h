@@ -24,6 +24,9 @@
 #include <rfid/tag_decoder.h>
 #include <vector>
 #include "rfid/global_vars.h"
+#include "reply_decoder.h"
+#include "latency_monitor.h"
+#include "stats_board.h"
 #include <time.h>
 #include <numeric>
 #include <fstream>
@@ -34,22 +37,36 @@ namespace rfid {
   {
     private:
     
-      float n_samples_TAG_BIT;
       int s_rate;
-      std::vector<float> pulse_bit;
-      float T_global;
-      gr_complex h_est;
-      char * char_bits;
+      float blf;                 // Hz, BLF the decoder is set for
+      float n_samples_TAG_BIT;
+      reply_decoder decoder;
+
+      rn16_bits RN16_bits;
+      epc_bits EPC_bits;
+      std::vector<tag_t> burst_end;
 
-      std::vector<float> tag_detection_EPC(std::vector<gr_complex> &EPC_samples_complex, int index);
-      std::vector<float> tag_detection_RN16(std::vector<gr_complex> &RN16_samples_complex);      
-      int tag_sync(const gr_complex * in, int size);
-       int check_crc(char * bits, int num_bits);
+      pmt::pmt_t burst_end_key, events_port, type_key, offset_key;
+      pmt::pmt_t rn16_event, rn16_fail_event, rn16_collision_event, epc_event, epc_fail_event;
+      pmt::pmt_t reads_port, epc_key, rssi_key, phase_key, time_key;
+
+      session::sptr reader_session;
+      READER_STATE * reader_state;
+      latency_monitor * latency;
+      stats_board * board;
+
+      void post_event(const pmt::pmt_t & type, uint64_t burst_end_offset);
+      void post_read(const uint16_t * words, int n_words, float rssi, float phase, uint64_t t_ns);
 
     public:
-      tag_decoder_impl(int sample_rate, std::vector<int> output_sizes);
+      tag_decoder_impl(session::sptr reader_session, int sample_rate, std::vector<int> output_sizes);
       ~tag_decoder_impl();
 
+      void set_sync_window(float tag_bits);
+      void set_sync_interpolation(bool interpolate);
+      void set_timing_mode(int mode);
+      void set_collision_detection(bool detect);
+
       void forecast (int noutput_items, gr_vector_int &ninput_items_required);
 
       int general_work(int noutput_items,
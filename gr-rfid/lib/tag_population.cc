@@ -0,0 +1,600 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <algorithm>
+#include <string.h>
+#include "tag_population.h"
+#include "crc.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    namespace {
+
+      // PIE limits of Gen2 in us: Tari <= TARI_MAX_D, RTcal <= 3 Tari, TRcal <= 3 RTcal
+      const float RTCAL_MAX_D = 3 * TARI_MAX_D;
+
+      // PC of a 96-bit EPC: length 6 words
+      const uint16_t PC_96 = 0x3000;
+
+      // Select actions (Table 6.30), on matching and on non-matching tags
+      enum SELECT_OP {OP_NOTHING, OP_ASSERT, OP_DEASSERT, OP_NEGATE};
+      const SELECT_OP SELECT_ACTIONS[8][2] =
+      {
+        {OP_ASSERT, OP_DEASSERT}, {OP_ASSERT, OP_NOTHING}, {OP_NOTHING, OP_DEASSERT}, {OP_NEGATE, OP_NOTHING},
+        {OP_DEASSERT, OP_ASSERT}, {OP_DEASSERT, OP_NOTHING}, {OP_NOTHING, OP_ASSERT}, {OP_NOTHING, OP_NEGATE}
+      };
+
+      // Asserted is SL set or inventoried flag A (false)
+      void apply(SELECT_OP op, bool & flag, bool asserted)
+      {
+        if (op == OP_ASSERT)
+          flag = asserted;
+        else if (op == OP_DEASSERT)
+          flag = !asserted;
+        else if (op == OP_NEGATE)
+          flag = !flag;
+      }
+    }
+
+    tag_population::tag_population(int dac_rate, int adc_rate, int n_tags, unsigned seed)
+      : dac_rate(dac_rate), adc_rate(adc_rate), interp(std::max(1, adc_rate / dac_rate)),
+        tags(n_tags), rng(seed),
+        snr_db(20), spread_db(0), gain(0.05), cfo(0), blf_tolerance(0),
+        pie_state(PIE_CW), t(0), last_rise(0), last_fall(0), peak(0), high(false),
+        n_intervals(0), tari(0), rtcal(0), trcal(0), n_rn16_replies(0),
+        session(0), cycles(1), trext(false)
+    {
+      memset(&d_stats, 0, sizeof(d_stats));
+      n_power_off_s = P_DOWN_D / 2 * (dac_rate / 1e6);
+
+      // BLF of the default Query until the first one is decoded
+      n_half_s = adc_rate / (2.0 * T_READER_FREQ);
+
+      std::uniform_real_distribution<float> uniform(0, 1);
+      leakage = std::polar(1.0f, float(2 * M_PI * uniform(rng)));
+      phasor = 1;
+      set_cfo(0);
+      init_tags();
+      update_channels();
+    }
+
+    void tag_population::init_tags()
+    {
+      std::uniform_real_distribution<float> uniform(0, 1);
+      for (int i = 0; i < tags.size(); i++)
+      {
+        tag & tg = tags[i];
+        tg.state = TAG_READY;
+        tg.slot = 0;
+        tg.q = 0;
+        memset(tg.inventoried, 0, sizeof(tg.inventoried));
+        tg.sl = false;
+        tg.rn16 = 0;
+        tg.n_reads = 0;
+
+        // PC, random EPC, CRC-16 over both
+        uint8_t pc_epc[14];
+        pc_epc[0] = PC_96 >> 8;
+        pc_epc[1] = PC_96 & 0xff;
+        for (int j = 2; j < 14; j++)
+          pc_epc[j] = rng();
+        uint16_t crc = crc16::compute(pc_epc, 14);
+
+        tg.epc.clear();
+        for (int j = 0; j < 14 * 8; j++)
+          tg.epc.set(j, (pc_epc[j >> 3] >> (7 - (j & 7))) & 1);
+        for (int j = 0; j < 16; j++)
+          tg.epc.set(14 * 8 + j, (crc >> (15 - j)) & 1);
+
+        tg.phase = 2 * M_PI * uniform(rng);
+        tg.snr_offset = uniform(rng) - 0.5f;
+        tg.blf_error = 2 * uniform(rng) - 1;
+      }
+    }
+
+    void tag_population::update_channels()
+    {
+      for (int i = 0; i < tags.size(); i++)
+      {
+        float ampl = gain * std::pow(10.0f, tags[i].snr_offset * spread_db / 20);
+        tags[i].h = std::polar(ampl, tags[i].phase);
+      }
+      // Noise power per ADC sample, half per component
+      float noise_power = gain * gain / std::pow(10.0f, snr_db / 10);
+      noise_std = std::sqrt(noise_power / 2);
+    }
+
+    void tag_population::set_snr(float snr_db, float spread_db)
+    {
+      this->snr_db = snr_db;
+      this->spread_db = spread_db;
+      update_channels();
+    }
+
+    void tag_population::set_backscatter_gain(float gain)
+    {
+      this->gain = gain;
+      update_channels();
+    }
+
+    void tag_population::set_cfo(float cfo_hz)
+    {
+      cfo = cfo_hz;
+      rotation = std::polar(1.0f, float(2 * M_PI * cfo / adc_rate));
+    }
+
+    void tag_population::set_blf_tolerance(float tolerance)
+    {
+      blf_tolerance = tolerance;
+    }
+
+    int tag_population::n_tags_read() const
+    {
+      int n = 0;
+      for (int i = 0; i < tags.size(); i++)
+        n += tags[i].n_reads > 0;
+      return n;
+    }
+
+    void tag_population::process(const float * in, int n_items, gr_complex * out)
+    {
+      const float us = 1e6 / dac_rate;
+
+      for (int i = 0; i < n_items; i++, t++)
+      {
+        float x = in[i];
+        peak = std::max(peak, x);
+
+        bool now_high = x > 0.5f * peak;
+        if (now_high != high)
+        {
+          high = now_high;
+          edge(high);
+        }
+        else if (high && pie_state == PIE_FRAME)
+        {
+          // No rising edge within the longest interval expected next: end of command
+          float limit = n_intervals == 0 ? 2 * TARI_MAX_D / us :
+                        n_intervals == 1 ? 1.1f * RTCAL_MAX_D / us :
+                        n_intervals == 2 ? 3.3f * rtcal : rtcal;
+          if (t - last_rise > limit)
+          {
+            if (n_intervals >= 2)
+              command();
+            pie_state = PIE_CW;
+          }
+        }
+        else if (!high && t - last_fall == n_power_off_s)
+          power_off();
+
+        // Carrier leakage and backscatter, both following the reader envelope
+        float env = peak > 0 ? x / peak : 0;
+        for (int k = 0; k < interp; k++)
+        {
+          long u = t * interp + k;
+          gr_complex s = leakage;
+          for (int r = 0; r < replies.size(); r++)
+          {
+            long index = (u - replies[r].start) / replies[r].n_half;
+            if (u >= replies[r].start && index < replies[r].levels.size())
+              s += replies[r].h * float(replies[r].levels[index]);
+          }
+          s *= env;
+          s += gr_complex(noise_std * noise(rng), noise_std * noise(rng));
+          out[i * interp + k] = s * phasor;
+          phasor *= rotation;
+        }
+      }
+      phasor /= std::abs(phasor);
+
+      // Drop finished replies
+      long now = t * interp;
+      for (int r = replies.size() - 1; r >= 0; r--)
+        if (replies[r].start + replies[r].levels.size() * replies[r].n_half < now)
+          replies.erase(replies.begin() + r);
+    }
+
+    void tag_population::edge(bool rising)
+    {
+      const float us = 1e6 / dac_rate;
+
+      if (!rising)
+      {
+        last_fall = t;
+        if (pie_state == PIE_CW)
+          pie_state = PIE_DELIM;
+        return;
+      }
+
+      long low = t - last_fall;
+      if (pie_state == PIE_FRAME && low * us > TARI_MAX_D)
+      {
+        // Too long for a PIE low pulse: drop the frame, the pulse may be a new delimiter
+        pie_state = PIE_DELIM;
+      }
+
+      if (pie_state == PIE_DELIM)
+      {
+        // Delimiter of 12.5 us, anything much longer is not a command
+        if (low * us < 2 * DELIM_D)
+        {
+          pie_state = PIE_FRAME;
+          n_intervals = 0;
+          trcal = 0;
+          bits.clear();
+        }
+        else
+          pie_state = PIE_CW;
+        last_rise = t;
+        return;
+      }
+
+      if (pie_state != PIE_FRAME)
+        return;
+
+      // Symbols are measured between rising edges
+      float interval = t - last_rise;
+      last_rise = t;
+      if (n_intervals == 0)
+        tari = interval;
+      else if (n_intervals == 1)
+        rtcal = interval;
+      else if (n_intervals == 2 && interval > 1.05f * rtcal)
+        trcal = interval;
+      else
+        bits.push_back(interval > rtcal / 2);
+      n_intervals++;
+    }
+
+    uint32_t tag_population::field(int first, int n) const
+    {
+      uint32_t value = 0;
+      for (int i = first; i < first + n; i++)
+        value = (value << 1) | bits[i];
+      return value;
+    }
+
+    void tag_population::command()
+    {
+      int n = bits.size();
+      bool known = true;
+      n_rn16_replies = 0;
+
+      if (trcal > 0)
+      {
+        // Only Query carries TRcal
+        if (n == QUERY_LENGTH && field(0, 4) == 0x8)
+        {
+          if (crc5::query(field(4, 13)) == field(17, 5))
+            query(field(4, 13));
+          else
+            d_stats.n_crc_errors++;
+        }
+        else
+          known = false;
+      }
+      else if (n == 4 && field(0, 2) == 0x0)
+        query_rep(field(2, 2));
+      else if (n == 18 && field(0, 2) == 0x1)
+        ack(field(2, 16));
+      else if (n == 9 && field(0, 4) == 0x9)
+        query_adjust(field(4, 2), field(6, 3));
+      else if (n == 8 && field(0, 8) == 0xc0)
+        nak();
+      else if (n > 4 && field(0, 4) == 0xa)
+        select(n);
+      else
+        known = false;
+
+      if (known)
+        d_stats.n_commands++;
+      if (n_rn16_replies > 0)
+        d_stats.n_reply_slots++;
+      if (n_rn16_replies > 1)
+        d_stats.n_collided_slots++;
+    }
+
+    void tag_population::query(uint32_t fields)
+    {
+      int dr = (fields >> 12) & 0x1;
+      cycles = 1 << ((fields >> 10) & 0x3);
+      trext = (fields >> 9) & 0x1;
+      int sel = (fields >> 7) & 0x3;
+      int s = (fields >> 5) & 0x3;
+      bool target = (fields >> 4) & 0x1;
+      int q = fields & 0xf;
+
+      // BLF = DR / TRcal
+      float trcal_us = trcal * 1e6 / dac_rate;
+      float blf = (dr ? 64.0f / 3 : 8.0f) / trcal_us * 1e6;
+      n_half_s = adc_rate / (2 * blf);
+
+      for (int i = 0; i < tags.size(); i++)
+      {
+        tag & tg = tags[i];
+
+        // A Query of the same session ends the previous round of an acknowledged tag
+        if (tg.state == TAG_ACKNOWLEDGED && s == session)
+          tg.inventoried[session] = !tg.inventoried[session];
+
+        bool match = tg.inventoried[s] == target && (sel < 2 || tg.sl == (sel == 3));
+        if (match)
+        {
+          tg.q = q;
+          pick_slot(tg);
+        }
+        else
+          tg.state = TAG_READY;
+      }
+      session = s;
+    }
+
+    void tag_population::query_rep(int s)
+    {
+      if (s != session)
+        return;
+
+      for (int i = 0; i < tags.size(); i++)
+      {
+        tag & tg = tags[i];
+        if (tg.state == TAG_ARBITRATE)
+        {
+          if (--tg.slot == 0)
+          {
+            tg.state = TAG_REPLY;
+            tg.rn16 = rng();
+            uint64_t word = uint64_t(tg.rn16) << 48;
+            backscatter(tg, &word, 16);
+          }
+        }
+        else if (tg.state == TAG_REPLY)
+        {
+          // Not acknowledged: wait for the next round
+          tg.state = TAG_ARBITRATE;
+          tg.slot = 0x7fff;
+        }
+        else if (tg.state == TAG_ACKNOWLEDGED)
+        {
+          tg.inventoried[session] = !tg.inventoried[session];
+          tg.state = TAG_READY;
+        }
+      }
+    }
+
+    void tag_population::query_adjust(int s, int updn)
+    {
+      if (s != session)
+        return;
+
+      int dq = updn == 0x6 ? 1 : (updn == 0x3 ? -1 : 0);
+      if (dq == 0 && updn != 0x0)
+        return;
+
+      for (int i = 0; i < tags.size(); i++)
+      {
+        tag & tg = tags[i];
+        if (tg.state == TAG_ARBITRATE || tg.state == TAG_REPLY)
+        {
+          tg.q = std::min(15, std::max(0, tg.q + dq));
+          pick_slot(tg);
+        }
+        else if (tg.state == TAG_ACKNOWLEDGED)
+        {
+          tg.inventoried[session] = !tg.inventoried[session];
+          tg.state = TAG_READY;
+        }
+      }
+    }
+
+    void tag_population::ack(uint16_t rn16)
+    {
+      for (int i = 0; i < tags.size(); i++)
+      {
+        tag & tg = tags[i];
+        if (tg.state != TAG_REPLY && tg.state != TAG_ACKNOWLEDGED)
+          continue;
+
+        if (tg.rn16 == rn16)
+        {
+          tg.state = TAG_ACKNOWLEDGED;
+          tg.n_reads++;
+          d_stats.n_acked++;
+          backscatter(tg, tg.epc.words(), epc_bits::n_bits);
+        }
+        else
+          tg.state = TAG_ARBITRATE;
+      }
+    }
+
+    void tag_population::nak()
+    {
+      for (int i = 0; i < tags.size(); i++)
+        if (tags[i].state == TAG_REPLY || tags[i].state == TAG_ACKNOWLEDGED)
+          tags[i].state = TAG_ARBITRATE;
+    }
+
+    void tag_population::select(int n_bits)
+    {
+      // Target, Action, MemBank, Pointer (EBV), Length, Mask, Truncate, CRC-16
+      int target = field(4, 3);
+      int action = field(7, 3);
+      int membank = field(10, 2);
+      int pos = 12;
+      uint32_t pointer = 0;
+      bool extended = true;
+      while (extended && pos + 8 <= n_bits)
+      {
+        extended = bits[pos];
+        pointer = (pointer << 7) | field(pos + 1, 7);
+        pos += 8;
+      }
+      if (pos + 8 > n_bits)
+        return;
+      int length = field(pos, 8);
+      pos += 8;
+      int mask = pos;
+      if (mask + length + 1 + 16 != n_bits)
+        return;
+
+      uint16_t crc = ~crc16::update_bits(crc16::PRESET, &bits[0], n_bits - 16);
+      if (crc != field(n_bits - 16, 16))
+      {
+        d_stats.n_crc_errors++;
+        return;
+      }
+      if (target > 4)
+        return;
+
+      for (int i = 0; i < tags.size(); i++)
+      {
+        tag & tg = tags[i];
+
+        // EPC memory is StoredCRC, PC, EPC; the other banks are not modelled
+        bool match = length == 0 || membank == 1;
+        for (int j = 0; j < length && match; j++)
+        {
+          uint32_t a = pointer + j;
+          bool bit = false;
+          if (a < 16)
+            bit = (tg.epc.field(epc_bits::n_bits - 16, 16) >> (15 - a)) & 1;
+          else if (a < epc_bits::n_bits)
+            bit = tg.epc.get(a - 16);
+          else
+            match = false;
+          if (match)
+            match = bit == bits[mask + j];
+        }
+
+        SELECT_OP op = SELECT_ACTIONS[action][match ? 0 : 1];
+        if (target == 4)
+          apply(op, tg.sl, true);
+        else
+          apply(op, tg.inventoried[target], false);
+        tg.state = TAG_READY;
+      }
+    }
+
+    void tag_population::pick_slot(tag & tg)
+    {
+      tg.slot = rng() & ((1 << tg.q) - 1);
+      if (tg.slot == 0)
+      {
+        tg.state = TAG_REPLY;
+        tg.rn16 = rng();
+        uint64_t word = uint64_t(tg.rn16) << 48;
+        backscatter(tg, &word, 16);
+      }
+      else
+        tg.state = TAG_ARBITRATE;
+    }
+
+    void tag_population::power_off()
+    {
+      for (int i = 0; i < tags.size(); i++)
+      {
+        tags[i].state = TAG_READY;
+        memset(tags[i].inventoried, 0, sizeof(tags[i].inventoried));
+        tags[i].sl = false;
+      }
+      replies.clear();
+      pie_state = PIE_CW;
+      d_stats.n_power_offs++;
+    }
+
+    void tag_population::backscatter(tag & tg, const uint64_t * words, int n_bits)
+    {
+      reply r;
+      r.n_half = n_half_s * (1 + blf_tolerance * tg.blf_error);
+      r.h = tg.h;
+
+      // T1 = max(RTcal, 10 Tpri) after the end of the command
+      float t1 = std::max(rtcal * interp, 20 * r.n_half);
+      r.start = last_rise * interp + long(t1);
+
+      if (cycles > 1)
+      {
+        miller(r, words, n_bits);
+        replies.push_back(r);
+        n_rn16_replies += n_bits == 16;
+        return;
+      }
+
+      // Optional pilot tone of 12 data-0, ending low before the preamble
+      if (trext)
+        for (int i = 0; i < PILOT_TONE; i++)
+        {
+          r.levels.push_back(1);
+          r.levels.push_back(-1);
+        }
+      for (int i = 0; i < 2 * TAG_PREAMBLE_BITS; i++)
+        r.levels.push_back(TAG_PREAMBLE[i] ? 1 : -1);
+
+      // FM0: inversion at every bit boundary and in the middle of a data-0, then the dummy 1
+      int level = 1;
+      for (int i = 0; i <= n_bits; i++)
+      {
+        bool bit = i == n_bits || ((words[i >> 6] >> (63 - (i & 63))) & 1);
+        level = -level;
+        r.levels.push_back(level);
+        if (!bit)
+          level = -level;
+        r.levels.push_back(level);
+      }
+
+      replies.push_back(r);
+      n_rn16_replies += n_bits == 16;
+    }
+
+    void tag_population::miller(reply & r, const uint64_t * words, int n_bits) const
+    {
+      // Pilot of 4 (16 with TRext) symbols of plain subcarrier, preamble 010111, data, dummy 1
+      const int PREAMBLE = 0x17;
+      int n_pilot = trext ? 16 : MILLER_PILOT_BITS;
+      int n_symbols = n_pilot + TAG_PREAMBLE_BITS + n_bits + 1;
+
+      // Baseband inverts between two 0s and in the middle of a 1; the subcarrier flips every chip
+      int level = 1;
+      bool prev_zero = false;
+      for (int i = 0; i < n_symbols; i++)
+      {
+        int j = i - n_pilot - TAG_PREAMBLE_BITS;
+        bool pilot = i < n_pilot;
+        bool bit = !pilot && (j < 0 ? (PREAMBLE >> -(j + 1)) & 1 :
+                              j == n_bits || ((words[j >> 6] >> (63 - (j & 63))) & 1));
+        if (!pilot && !bit && prev_zero)
+          level = -level;
+        prev_zero = !pilot && !bit;
+        for (int k = 0; k < 2 * cycles; k++)
+        {
+          if (bit && k == cycles)
+            level = -level;
+          r.levels.push_back((k & 1) ? -level : level);
+        }
+      }
+    }
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,174 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_TAG_POPULATION_H
+#define INCLUDED_RFID_TAG_POPULATION_H
+
+#include <rfid/api.h>
+#include <gnuradio/gr_complex.h>
+#include <random>
+#include <vector>
+#include <stdint.h>
+#include "packed_bits.h"
+#include "reply_decoder.h"
+
+namespace gr {
+  namespace rfid {
+
+    struct population_stats
+    {
+      long n_commands;           // reader commands decoded (CRC errors excluded)
+      long n_crc_errors;         // Query or Select with a bad CRC
+      long n_reply_slots;        // RN16 slots with at least one reply
+      long n_collided_slots;     // RN16 slots with more than one reply
+      long n_acked;              // EPC replies
+      long n_power_offs;         // carrier off long enough to reset the tags
+    };
+
+    /*!
+     * \brief Gen2 tags in front of the reader, for load tests without a radio.
+     *
+     * Decodes the PIE commands of the reader output (Query, QueryRep,
+     * QueryAdjust, ACK, NAK, Select) and runs the tag state machine of each
+     * tag: slot counter, S0-S3 inventoried flags, SL flag and a new RN16 per
+     * reply. Replies are FM0 or Miller-M backscatter at the BLF set by TRcal
+     * and DR of the last Query, with the M of that Query, starting T1 after
+     * the last rising edge of the command.
+     *
+     * The ADC signal is the carrier leaking from transmitter to receiver
+     * plus the backscatter of every replying tag, each through its own
+     * channel (random phase, per-tag SNR and BLF error), so that tags that
+     * pick the same slot collide. CFO and white noise are applied on top.
+     * Tags lose their state when the carrier is off for P_DOWN_D / 2.
+     */
+    class RFID_API tag_population
+    {
+      public:
+        /*!
+         * adc_rate must be a multiple of dac_rate; each reader sample
+         * yields adc_rate / dac_rate ADC samples.
+         */
+        tag_population(int dac_rate, int adc_rate, int n_tags, unsigned seed = 0);
+
+        /*!
+         * Consumes n_items reader samples (carrier envelope, any amplitude)
+         * and writes n_items * interpolation() ADC samples to out.
+         */
+        void process(const float * in, int n_items, gr_complex * out);
+
+        // Backscatter to noise power per ADC sample; tags are spread uniformly over +/- spread_db / 2
+        void set_snr(float snr_db, float spread_db = 0);
+        // Backscatter amplitude relative to the carrier leakage
+        void set_backscatter_gain(float gain);
+        void set_cfo(float cfo_hz);
+        // Maximum relative BLF error of a tag (Gen2 allows up to 0.22 at 40 kHz)
+        void set_blf_tolerance(float tolerance);
+
+        int interpolation() const { return interp; }
+        int n_tags() const { return tags.size(); }
+
+        // PC + EPC + CRC16 as backscattered, and number of EPC replies of tag i
+        const epc_bits & epc(int i) const { return tags[i].epc; }
+        int n_reads(int i) const { return tags[i].n_reads; }
+        // Number of tags acknowledged at least once
+        int n_tags_read() const;
+
+        const population_stats & stats() const { return d_stats; }
+
+      private:
+        enum TAG_STATE {TAG_READY, TAG_ARBITRATE, TAG_REPLY, TAG_ACKNOWLEDGED};
+
+        struct tag
+        {
+          TAG_STATE state;
+          int slot;
+          int q;
+          bool inventoried[4];   // true is B
+          bool sl;
+          uint16_t rn16;
+          epc_bits epc;
+          float phase, snr_offset;   // fixed channel draws, SNR offset in [-0.5, 0.5]
+          gr_complex h;
+          float blf_error;
+          int n_reads;
+        };
+
+        // Levels of a reply, one per FM0 half bit or Miller chip (half subcarrier cycle)
+        struct reply
+        {
+          long start;            // first ADC sample
+          float n_half;          // ADC samples per level
+          gr_complex h;
+          std::vector<int8_t> levels;
+        };
+
+        enum PIE_STATE {PIE_CW, PIE_DELIM, PIE_FRAME};
+
+        int dac_rate, adc_rate, interp;
+        std::vector<tag> tags;
+        std::vector<reply> replies;
+        population_stats d_stats;
+        std::mt19937 rng;
+
+        // Channel
+        float snr_db, spread_db, gain, cfo, blf_tolerance, noise_std;
+        gr_complex leakage, rotation, phasor;
+        std::normal_distribution<float> noise;
+
+        // PIE decoder, times in reader samples
+        PIE_STATE pie_state;
+        long t, last_rise, last_fall;
+        float peak;
+        bool high;
+        int n_intervals;
+        float tari, rtcal, trcal;
+        long n_power_off_s;
+        std::vector<int> bits;
+        int n_rn16_replies;
+
+        // Link timing of the current round
+        int session;
+        float n_half_s;          // ADC samples per FM0 half bit
+        int cycles;              // M: 1 FM0, 2/4/8 Miller
+        bool trext;
+
+        void init_tags();
+        void update_channels();
+        void power_off();
+
+        void edge(bool rising);
+        void command();
+        void query(uint32_t fields);
+        void query_rep(int s);
+        void query_adjust(int s, int updn);
+        void ack(uint16_t rn16);
+        void nak();
+        void select(int n_bits);
+
+        void pick_slot(tag & tg);
+        void backscatter(tag & tg, const uint64_t * words, int n_bits);
+        void miller(reply & r, const uint64_t * words, int n_bits) const;
+        uint32_t field(int first, int n) const;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_TAG_POPULATION_H */
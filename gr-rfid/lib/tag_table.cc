@@ -0,0 +1,132 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <string.h>
+#include "tag_table.h"
+
+namespace gr {
+  namespace rfid {
+
+    const int tag_table::MAX_WORDS;
+
+    tag_table::tag_table(int capacity)
+    {
+      int n_slots = 2;
+      while (n_slots < 2 * capacity)
+        n_slots <<= 1;
+      slots.assign(n_slots, slot{-1, 0});
+      mask = n_slots - 1;
+      records.reserve(n_slots / 2);
+    }
+
+    // FNV-1a over the words
+    uint32_t tag_table::hash(const uint16_t * words, int n_words)
+    {
+      uint32_t h = 2166136261u;
+      for (int i = 0; i < n_words; i++)
+      {
+        h = (h ^ (words[i] & 0xff)) * 16777619u;
+        h = (h ^ (words[i] >> 8)) * 16777619u;
+      }
+      return h;
+    }
+
+    bool tag_table::same_tag(const tag_record & r, const uint16_t * words, int n_words)
+    {
+      return r.n_words == n_words && memcmp(r.words, words, n_words * sizeof(uint16_t)) == 0;
+    }
+
+    // Slot holding the tag, or the empty slot where it goes
+    int tag_table::probe(const uint16_t * words, int n_words, uint32_t h) const
+    {
+      uint32_t i = h & mask;
+      while (slots[i].index >= 0 && !(slots[i].hash == h && same_tag(records[slots[i].index], words, n_words)))
+        i = (i + 1) & mask;
+      return i;
+    }
+
+    const tag_table::tag_record & tag_table::add_read(const uint16_t * words, int n_words, uint64_t t_ns, float rssi, float phase)
+    {
+      n_words = std::min(n_words, MAX_WORDS);
+      uint32_t h = hash(words, n_words);
+      int i = probe(words, n_words, h);
+
+      if (slots[i].index < 0)
+      {
+        if (records.size() == capacity())
+        {
+          grow();
+          i = probe(words, n_words, h);
+        }
+
+        tag_record r;
+        memset(&r, 0, sizeof(r));
+        memcpy(r.words, words, n_words * sizeof(uint16_t));
+        r.n_words = n_words;
+        r.first_seen_ns = t_ns;
+        slots[i].index = records.size();
+        slots[i].hash = h;
+        records.push_back(r);
+      }
+
+      tag_record & r = records[slots[i].index];
+      r.n_reads++;
+      r.last_seen_ns = t_ns;
+      r.rssi = rssi;
+      r.phase = phase;
+      return r;
+    }
+
+    const tag_table::tag_record * tag_table::find(const uint16_t * words, int n_words) const
+    {
+      n_words = std::min(n_words, MAX_WORDS);
+      int i = probe(words, n_words, hash(words, n_words));
+      return slots[i].index < 0 ? NULL : &records[slots[i].index];
+    }
+
+    // Doubles the capacity and rebuilds the index; records keep their order
+    void tag_table::grow()
+    {
+      records.reserve(slots.size());
+      slots.assign(2 * slots.size(), slot{-1, 0});
+      mask = slots.size() - 1;
+      for (int k = 0; k < records.size(); k++)
+      {
+        uint32_t h = hash(records[k].words, records[k].n_words);
+        uint32_t i = h & mask;
+        while (slots[i].index >= 0)
+          i = (i + 1) & mask;
+        slots[i].index = k;
+        slots[i].hash = h;
+      }
+    }
+
+    void tag_table::clear()
+    {
+      records.clear();
+      std::fill(slots.begin(), slots.end(), slot{-1, 0});
+    }
+  } /* namespace rfid */
+} /* namespace gr */
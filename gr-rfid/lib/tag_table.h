@@ -0,0 +1,94 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_TAG_TABLE_H
+#define INCLUDED_RFID_TAG_TABLE_H
+
+#include <rfid/api.h>
+#include <vector>
+#include <stdint.h>
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Tags seen by a reader chain, keyed by their full PC + EPC.
+     *
+     * Records are stored densely in order of first read; an open
+     * addressing index (linear probing, kept at most half full) maps the
+     * hash of the PC + EPC words to the record. Both are allocated for
+     * the capacity given to the constructor, so reads do not allocate
+     * until more tags than that are seen, when the table doubles.
+     *
+     * Not thread safe: the session guards it with READER_STATS::tags_lock.
+     */
+    class RFID_API tag_table
+    {
+      public:
+        static const int MAX_WORDS = 32;   // PC + 496-bit EPC
+
+        struct tag_record
+        {
+          uint16_t words[MAX_WORDS];       // PC + EPC as backscattered
+          int n_words;
+          long n_reads;
+          uint64_t first_seen_ns, last_seen_ns;
+          float rssi, phase;               // of the last read: dB over the noise, rad
+        };
+
+        tag_table(int capacity);
+
+        // PC + EPC words announced by the PC length field
+        static int pc_words(uint16_t pc) { return 1 + (pc >> 11); }
+
+        // Counts a read of the tag (n_words up to MAX_WORDS) and returns its record,
+        // valid until the next read
+        const tag_record & add_read(const uint16_t * words, int n_words, uint64_t t_ns, float rssi, float phase);
+        // NULL for an unknown tag
+        const tag_record * find(const uint16_t * words, int n_words) const;
+
+        int size() const { return records.size(); }
+        int capacity() const { return slots.size() / 2; }
+        // Records in order of first read
+        const tag_record & record(int i) const { return records[i]; }
+
+        void clear();
+
+      private:
+        struct slot
+        {
+          int32_t index;                   // into records, -1 if empty
+          uint32_t hash;
+        };
+
+        std::vector<tag_record> records;
+        std::vector<slot> slots;
+        uint32_t mask;
+
+        static uint32_t hash(const uint16_t * words, int n_words);
+        static bool same_tag(const tag_record & r, const uint16_t * words, int n_words);
+        int probe(const uint16_t * words, int n_words, uint32_t h) const;
+        void grow();
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_TAG_TABLE_H */
@@ -0,0 +1,192 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <algorithm>
+#include "timing_recovery.h"
+
+namespace gr {
+  namespace rfid {
+
+    // Candidate periods of the grid search
+    const int GRID_STEPS = 20;
+    // Coarse candidates and refinements of the coarse-to-fine search
+    const int COARSE_STEPS = 5;
+    const int FINE_ITERATIONS = 4;
+    // Early-late gate: offset of the early/late samples (in half-bits) and loop gains
+    const float EL_OFFSET = 0.25;
+    const float EL_PHASE_GAIN = 0.2;
+    const float EL_PERIOD_GAIN = 0.01;
+    // Largest period deviation tracked by the early-late loop
+    const float EL_MAX_DEVIATION = 0.05;
+
+    // Half-bits of an FM0 EPC; longer (Miller) replies get finer period steps, for the same drift per step
+    static int refinement(int n_half_bits)
+    {
+      return std::max(1, n_half_bits / (2 * (EPC_BITS - 1)));
+    }
+
+    timing_recovery::timing_recovery(float n_samples_TAG_BIT, TIMING_MODE mode)
+      : d_mode(mode)
+    {
+      half_bit = n_samples_TAG_BIT/2.0;
+      min_val = half_bit - half_bit/100;
+      max_val = half_bit + half_bit/100;
+    }
+
+    float timing_recovery::recover(const float * magn_squared, int size, float index, int n_half_bits, float * instants)
+    {
+      float T;
+      if (d_mode == TIMING_EARLY_LATE)
+        return early_late(magn_squared, size, index, n_half_bits, instants);
+      else if (d_mode == TIMING_COARSE_TO_FINE)
+        T = coarse_to_fine(magn_squared, size, index, n_half_bits);
+      else
+        T = grid_search(magn_squared, size, index, n_half_bits);
+
+      for (int j = 0; j < n_half_bits; j++)
+      {
+        if (j % 2 == 0)
+          instants[j] = j/2 * (2*T) + index;
+        else
+          instants[j] = j/2 * 2*T + T + index;
+      }
+      return T;
+    }
+
+    float timing_recovery::energy(const float * magn_squared, int size, float index, int n_half_bits, float T) const
+    {
+      // Last half-bit instant inside the burst
+      int n = n_half_bits;
+      while (n > 0 && (int) ((n - 1) * T + index) >= size)
+        n--;
+
+      // Independent partial sums, so that the loads are not serialized on one addition
+      float sum[4] = {0, 0, 0, 0};
+      int i = 0;
+      for (; i + 4 <= n; i += 4)
+      {
+        sum[0] += magn_squared[(int) (i * T + index)];
+        sum[1] += magn_squared[(int) ((i + 1) * T + index)];
+        sum[2] += magn_squared[(int) ((i + 2) * T + index)];
+        sum[3] += magn_squared[(int) ((i + 3) * T + index)];
+      }
+      for (; i < n; i++)
+        sum[0] += magn_squared[(int) (i * T + index)];
+      return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    }
+
+    float timing_recovery::grid_search(const float * magn_squared, int size, float index, int n_half_bits) const
+    {
+      int n_steps = GRID_STEPS * refinement(n_half_bits);
+      int index_T = 0;
+      float max_energy = 0;
+      for (int t = 0; t < n_steps; t++)
+      {
+        float e = energy(magn_squared, size, index, n_half_bits, min_val + t*(max_val-min_val)/(n_steps-1));
+        if (t == 0 || e > max_energy)
+        {
+          max_energy = e;
+          index_T = t;
+        }
+      }
+      return min_val + index_T*(max_val-min_val)/(n_steps-1);
+    }
+
+    float timing_recovery::coarse_to_fine(const float * magn_squared, int size, float index, int n_half_bits) const
+    {
+      float step = (max_val-min_val)/(COARSE_STEPS-1);
+      float best_T = min_val, best_energy = 0;
+      for (int t = 0; t < COARSE_STEPS; t++)
+      {
+        float T = min_val + t*step;
+        float e = energy(magn_squared, size, index, n_half_bits, T);
+        if (t == 0 || e > best_energy)
+        {
+          best_energy = e;
+          best_T = T;
+        }
+      }
+
+      // Halve the step around the best period
+      int n_iterations = FINE_ITERATIONS + (int) std::ceil(std::log2(refinement(n_half_bits)));
+      for (int r = 0; r < n_iterations; r++)
+      {
+        step /= 2;
+        float T_early = best_T - step, T_late = best_T + step;
+        float e_early = energy(magn_squared, size, index, n_half_bits, T_early);
+        float e_late  = energy(magn_squared, size, index, n_half_bits, T_late);
+        if (e_early > best_energy && e_early >= e_late)
+        {
+          best_energy = e_early;
+          best_T = T_early;
+        }
+        else if (e_late > best_energy)
+        {
+          best_energy = e_late;
+          best_T = T_late;
+        }
+      }
+      return best_T;
+    }
+
+    // Linear interpolation of the squared magnitude at a fractional position
+    static float interpolate(const float * magn_squared, int size, float x)
+    {
+      if (x <= 0)
+        return magn_squared[0];
+      int k = (int) x;
+      if (k >= size - 1)
+        return magn_squared[size - 1];
+      float frac = x - k;
+      return (1 - frac) * magn_squared[k] + frac * magn_squared[k + 1];
+    }
+
+    float timing_recovery::early_late(const float * magn_squared, int size, float index, int n_half_bits, float * instants) const
+    {
+      float T = half_bit;
+      float p = index;
+      float offset = EL_OFFSET * half_bit;
+
+      for (int j = 0; j < n_half_bits; j++)
+      {
+        instants[j] = std::min(p, (float) (size - 1));
+
+        // Positive error: the energy peak is later than the current instant.
+        // Equal consecutive half-bits give a flat peak and no correction.
+        float early = interpolate(magn_squared, size, p - offset);
+        float late  = interpolate(magn_squared, size, p + offset);
+        float err = (late - early) / (late + early + 1e-12f);
+
+        T = T + EL_PERIOD_GAIN * half_bit * err;
+        T = std::max(half_bit * (1 - EL_MAX_DEVIATION), std::min(half_bit * (1 + EL_MAX_DEVIATION), T));
+        p = p + T + EL_PHASE_GAIN * half_bit * err;
+      }
+
+      if (n_half_bits < 2)
+        return T;
+      return (instants[n_half_bits - 1] - instants[0]) / (n_half_bits - 1);
+    }
+  } /* namespace rfid */
+} /* namespace gr */
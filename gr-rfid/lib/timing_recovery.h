@@ -0,0 +1,69 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_TIMING_RECOVERY_H
+#define INCLUDED_RFID_TIMING_RECOVERY_H
+
+#include <rfid/api.h>
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Half-bit timing recovery of a tag reply.
+     *
+     * Works on the squared magnitude of the matched filter output, which
+     * peaks in the middle of each half-bit. Three modes are available:
+     *  - TIMING_GRID_SEARCH: energy of the half-bit instants for 20 periods within +-1% of nominal
+     *  - TIMING_COARSE_TO_FINE: 5 coarse periods, then the step is halved around the best one
+     *  - TIMING_EARLY_LATE: early-late gate loop tracking phase and period from half-bit to half-bit
+     *
+     * Miller replies are sampled per chip, which lasts an FM0 half-bit at the
+     * same BLF; the searches step finer on replies longer than an FM0 EPC.
+     */
+    class RFID_API timing_recovery
+    {
+      public:
+        timing_recovery(float n_samples_TAG_BIT, TIMING_MODE mode = TIMING_GRID_SEARCH);
+
+        /*!
+         * Fills instants with the sampling instants of n_half_bits half-bits,
+         * the first one at index, and returns the estimated half-bit period.
+         */
+        float recover(const float * magn_squared, int size, float index, int n_half_bits, float * instants);
+
+        TIMING_MODE mode() const { return d_mode; }
+        void set_mode(TIMING_MODE mode) { d_mode = mode; }
+
+      private:
+        TIMING_MODE d_mode;
+        float half_bit, min_val, max_val;
+
+        float energy(const float * magn_squared, int size, float index, int n_half_bits, float T) const;
+        float grid_search(const float * magn_squared, int size, float index, int n_half_bits) const;
+        float coarse_to_fine(const float * magn_squared, int size, float index, int n_half_bits) const;
+        float early_late(const float * magn_squared, int size, float index, int n_half_bits, float * instants) const;
+    };
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_TIMING_RECOVERY_H */
@@ -0,0 +1,312 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <algorithm>
+#include <string.h>
+#include "waveform_cache.h"
+#include "reply_decoder.h"
+#include "crc.h"
+#include "rfid/global_vars.h"
+
+namespace gr {
+  namespace rfid {
+
+    waveform_cache::waveform_cache(int dac_rate)
+      : cycles(TAG_ENCODING)
+    {
+      sample_d = 1.0/dac_rate * pow(10,6);
+
+      // Number of samples for transmitting (PIE symbols: set_link)
+      n_cw_s    = CW_D    / sample_d;
+      n_delim_s = DELIM_D / sample_d;
+
+      // CW waveforms of different sizes (after Query and ACK: set_link, set_cycles_per_symbol)
+      n_p_down_s    = (P_DOWN_D)/sample_d;
+      n_cwsettle_s  = TS_D/sample_d;                   //SETTLE
+
+      p_down.resize(n_p_down_s);        // Power down samples
+      settle.resize(n_cwsettle_s);      // Sent before first Interrogator Command (TAG wakeup time)
+
+      std::fill_n(settle.begin(), settle.size(), 1);
+
+      // Construct vectors (resize() default initialization is zero)
+      cw.resize(n_cw_s);
+      delim.resize(n_delim_s);
+
+      // Fill vectors with data
+      std::fill_n(cw.begin(), cw.size(), 1);
+
+      set_link(link_timing());
+    }
+
+    int waveform_cache::cw_length(const link_timing & link, int n_t1, int n_bits, int m) const
+    {
+      return round((n_t1*link.t1_d + link.t2_d + reply_decoder::reply_length(n_bits, m) * link.tag_bit_d) / sample_d);
+    }
+
+    void waveform_cache::set_link(const link_timing & link)
+    {
+      this->link = link;
+
+      // PIE symbols of the Tari, each ending with a low pulse
+      n_data0_s = round(link.tari_d / sample_d);
+      n_data1_s = round(link.data1 * link.tari_d / sample_d);
+      n_pw_s    = round(link.pw_d / sample_d);
+      data_0.assign(n_data0_s, 0);
+      data_1.assign(n_data1_s, 0);
+      rtcal.assign(n_data0_s + n_data1_s, 0);
+      std::fill_n(data_0.begin(), data_0.size() - n_pw_s, 1);
+      std::fill_n(data_1.begin(), data_1.size() - n_pw_s, 1);
+      std::fill_n(rtcal.begin(), rtcal.size() - n_pw_s, 1); // RTcal
+
+      // TRcal sets the BLF
+      n_trcal_s = round(link.trcal_d / sample_d);
+      trcal.assign(n_trcal_s, 0);
+      std::fill_n(trcal.begin(), trcal.size() - n_pw_s, 1); // TRcal
+
+      // create framesync
+      frame_sync.clear();
+      frame_sync.insert( frame_sync.end(), delim.begin() , delim.end() );
+      frame_sync.insert( frame_sync.end(), data_0.begin(), data_0.end() );
+      frame_sync.insert( frame_sync.end(), rtcal.begin() , rtcal.end() );
+
+      // create preamble
+      preamble = frame_sync;
+      preamble.insert( preamble.end(), trcal.begin(), trcal.end() );
+
+      // nak + CW
+      nak = frame_sync;
+      append_bits(nak, NAK_CODE, 8);
+      nak.insert( nak.end(), cw.begin(), cw.end() );
+
+      // ACK header
+      ack_header = frame_sync;
+      append_bits(ack_header, ACK_CODE, 2);
+
+      // One prerendered segment per byte value (RN16 of ACK, Query word)
+      data_bytes.clear();
+      data_byte_offset[0] = 0;
+      for(int byte = 0; byte < 256; byte++)
+      {
+        int bits[8];
+        for(int i = 0; i < 8; i++)
+          bits[i] = (byte >> (7 - i)) & 0x01;
+        append_bits(data_bytes, bits, 8);
+        data_byte_offset[byte + 1] = data_bytes.size();
+      }
+
+      // Sent after select: T4
+      n_cwselect_s = round(link.t4_d / sample_d);
+      cw_select.assign(n_cwselect_s, 1);
+      if (!select.empty())
+        set_select(select_bits);
+
+      set_cycles_per_symbol(cycles);
+    }
+
+    void waveform_cache::set_cycles_per_symbol(int m)
+    {
+      cycles = m;
+      n_cwquery_s   = cw_length(link, 1, RN16_BITS, m);   //RN16
+      n_cwack_s     = cw_length(link, 3, EPC_BITS, m);    //EPC   if it is longer than nominal it wont cause tags to change inventoried flag
+
+      cw_query.assign(n_cwquery_s, 1);  // Sent after query/query rep
+      cw_ack.assign(n_cwack_s, 1);      // Sent after ack
+
+      // query rep + CW for RN16
+      const int query_rep_code[4] = {0,0,0,0};
+      query_rep = frame_sync;
+      append_bits(query_rep, query_rep_code, 4);
+      query_rep.insert( query_rep.end(), cw_query.begin(), cw_query.end() );
+
+      // query adjust (increment, unchanged, decrement) + CW for RN16
+      for(int i = 0; i < 3; i++)
+      {
+        query_adjust[i] = frame_sync;
+        append_bits(query_adjust[i], QADJ_CODE, 4);
+        append_bits(query_adjust[i], SESSION, 2);
+        append_bits(query_adjust[i], Q_UPDN[i], 3);
+        query_adjust[i].insert( query_adjust[i].end(), cw_query.begin(), cw_query.end() );
+      }
+    }
+
+    void waveform_cache::set_select(const std::vector<float> & select_bits)
+    {
+      this->select_bits = select_bits;
+      select = frame_sync;
+      append_bits(select, select_bits);
+      select.insert( select.end(), cw_select.begin(), cw_select.end() );
+    }
+
+    int waveform_cache::emit_settle(float * out) const
+    {
+      return copy(settle, out);
+    }
+
+    int waveform_cache::emit_power_down(float * out) const
+    {
+      return copy(p_down, out);
+    }
+
+    int waveform_cache::emit_query(uint32_t query, float * out) const
+    {
+      int written = copy(preamble, out);
+      written += emit_bits(query, QUERY_LENGTH, &out[written]);
+      written += copy(cw_query, &out[written]);
+      return written;
+    }
+
+    int waveform_cache::emit_query_rep(float * out) const
+    {
+      return copy(query_rep, out);
+    }
+
+    int waveform_cache::emit_query_adjust(int q_change, float * out) const
+    {
+      return copy(query_adjust[q_change], out);
+    }
+
+    int waveform_cache::emit_select(float * out) const
+    {
+      return copy(select, out);
+    }
+
+    int waveform_cache::emit_nak(float * out) const
+    {
+      return copy(nak, out);
+    }
+
+    int waveform_cache::emit_ack(uint16_t rn16, float * out) const
+    {
+      int written = copy(ack_header, out);
+      written += emit_bits(rn16, 16, &out[written]);
+      written += copy(cw_ack, &out[written]);
+      return written;
+    }
+
+    int waveform_cache::max_burst_size() const
+    {
+      // Longest PIE symbols (largest Tari and data-1) and TRcal of 3 RTcal, all data-1 symbols;
+      // CW long enough for Miller-8 replies at the lowest BLF
+      link_timing slowest(BLF_MIN, 0, TARI_MAX_D, DATA1_MAX_T);
+      int max_data0 = std::ceil(slowest.tari_d / sample_d);
+      int max_data1 = std::ceil(slowest.data1 * slowest.tari_d / sample_d);
+      int max_frame_sync = delim.size() + 2 * max_data0 + max_data1;
+      int max_preamble = max_frame_sync + std::ceil(3 * slowest.rtcal_d / sample_d) + 1;
+      int max_cw_query = cw_length(slowest, 1, RN16_BITS, 8);
+
+      int max_ack = max_frame_sync + (2 + 16) * max_data1 + cw_length(slowest, 3, EPC_BITS, 8);
+      int max_query = max_preamble + QUERY_LENGTH * max_data1 + max_cw_query;
+      int max_query_rep = max_frame_sync + 4 * max_data1 + max_cw_query;
+      int max_query_adjust = max_frame_sync + 9 * max_data1 + max_cw_query;
+      int max_select = max_frame_sync + select_bits.size() * max_data1 + std::ceil(slowest.t4_d / sample_d);
+      int max_nak = max_frame_sync + 8 * max_data1 + cw.size();
+
+      int max_size = std::max(max_ack, max_query);
+      max_size = std::max(max_size, (int) settle.size());
+      max_size = std::max(max_size, (int) p_down.size());
+      max_size = std::max(max_size, max_query_rep);
+      max_size = std::max(max_size, max_query_adjust);
+      max_size = std::max(max_size, max_select);
+      max_size = std::max(max_size, max_nak);
+      return max_size;
+    }
+
+    void waveform_cache::append_bits(std::vector<float> & burst, const int * bits, int n_bits) const
+    {
+      for(int i = 0; i < n_bits; i++)
+      {
+        if(bits[i] == 1)
+          burst.insert( burst.end(), data_1.begin(), data_1.end() );
+        else
+          burst.insert( burst.end(), data_0.begin(), data_0.end() );
+      }
+    }
+
+    void waveform_cache::append_bits(std::vector<float> & burst, const std::vector<float> & bits) const
+    {
+      for(int i = 0; i < bits.size(); i++)
+      {
+        if(bits[i] == 1)
+          burst.insert( burst.end(), data_1.begin(), data_1.end() );
+        else
+          burst.insert( burst.end(), data_0.begin(), data_0.end() );
+      }
+    }
+
+    // The n_bits LSBs of bits, MSB first: whole bytes from the prerendered
+    // segments, the remaining bits one symbol at a time
+    int waveform_cache::emit_bits(uint32_t bits, int n_bits, float * out) const
+    {
+      int written = 0;
+      for(; n_bits >= 8; n_bits -= 8)
+      {
+        int byte = (bits >> (n_bits - 8)) & 0xff;
+        int n = data_byte_offset[byte + 1] - data_byte_offset[byte];
+        memcpy(&out[written], &data_bytes[data_byte_offset[byte]], sizeof(float) * n);
+        written += n;
+      }
+      for(; n_bits > 0; n_bits--)
+        written += copy(((bits >> (n_bits - 1)) & 0x01) ? data_1 : data_0, &out[written]);
+      return written;
+    }
+
+    int waveform_cache::copy(const std::vector<float> & burst, float * out)
+    {
+      if(burst.empty())
+        return 0;
+      memcpy(out, &burst[0], sizeof(float) * burst.size());
+      return burst.size();
+    }
+
+    static uint32_t append_field(uint32_t word, const int * bits, int n_bits)
+    {
+      for(int i = 0; i < n_bits; i++)
+        word = (word << 1) | bits[i];
+      return word;
+    }
+
+    // Query word: code, DR, M, TRext, Sel, Session, Target, Q, CRC-5
+    uint32_t query_word(bool select, int q, int m, int dr)
+    {
+      // M: 00 FM0, 01 Miller-2, 10 Miller-4, 11 Miller-8
+      int m_code = 0;
+      while ((1 << m_code) < m)
+        m_code++;
+
+      uint32_t payload = dr;
+      payload = (payload << 2) | m_code;
+      payload = append_field(payload, &TREXT, 1);
+      payload = append_field(payload, select ? SEL_SL : SEL_ALL, 2);
+      payload = append_field(payload, SESSION, 2);
+      payload = append_field(payload, &TARGET, 1);
+      payload = append_field(payload, Q_VALUE[q], 4);
+
+      uint32_t word = append_field(0, QUERY_CODE, 4);
+      word = (word << 13) | payload;
+      return (word << 5) | crc5::query(payload);
+    }
+  } /* namespace rfid */
+} /* namespace gr */
@@ -0,0 +1,101 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2015 <Nikos Kargas (nkargas@isc.tuc.gr)>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_RFID_WAVEFORM_CACHE_H
+#define INCLUDED_RFID_WAVEFORM_CACHE_H
+
+#include <rfid/api.h>
+#include <vector>
+#include <stdint.h>
+#include "link_timing.h"
+
+namespace gr {
+  namespace rfid {
+
+    /*!
+     * \brief Reader commands rendered once into contiguous sample buffers.
+     *
+     * Every command that does not depend on tag data is rendered together
+     * with the carrier wave that follows it, so that it can be emitted with a
+     * single copy. Commands carrying a variable field are assembled from a
+     * fixed header and prerendered segments for each of the 256 byte values:
+     * ACK from frame-sync + ACK code and the two RN16 bytes, Query from the
+     * preamble and the 22-bit command word, so that Q, Session or Target can
+     * change from one round to the next without rendering.
+     */
+    class RFID_API waveform_cache
+    {
+      public:
+        waveform_cache(int dac_rate);
+
+        // Render the bursts that depend on the reader configuration
+        void set_select(const std::vector<float> & select_bits);
+        // PIE symbols, preamble and frame-sync for a new Tari, TRcal and CW after every command for a new BLF
+        void set_link(const link_timing & link);
+        // CW after Query, QueryRep, QueryAdjust and ACK for replies of M cycles per symbol (1 FM0, 2/4/8 Miller)
+        void set_cycles_per_symbol(int m);
+        const link_timing & get_link() const { return link; }
+
+        // Each emit_* copies a complete burst to out and returns its size
+        int emit_settle(float * out) const;
+        int emit_power_down(float * out) const;
+        int emit_query(uint32_t query, float * out) const;     // QUERY_LENGTH bits, first bit MSB
+        int emit_query_rep(float * out) const;
+        int emit_query_adjust(int q_change, float * out) const; // 0-> increment, 1-> unchanged, 2-> decrement
+        int emit_select(float * out) const;
+        int emit_nak(float * out) const;
+        int emit_ack(uint16_t rn16, float * out) const;
+
+        // Largest burst that can be emitted by a single emit_* call, for any link and tag encoding
+        int max_burst_size() const;
+
+        float n_data0_s, n_data1_s, n_cw_s, n_pw_s, n_delim_s, n_trcal_s;
+        int n_cwquery_s, n_cwack_s, n_cwselect_s, n_cwsettle_s, n_p_down_s;
+
+      private:
+        float sample_d;
+        link_timing link;
+        int cycles;
+        std::vector<float> data_0, data_1, cw, delim, rtcal, trcal, frame_sync, preamble, select_bits;
+        std::vector<float> cw_query, cw_ack, cw_select;
+
+        // Complete bursts (command + CW)
+        std::vector<float> settle, p_down, query_rep, select, nak, query_adjust[3];
+
+        // ACK = ack_header + byte[RN16 >> 8] + byte[RN16 & 0xff] + cw_ack
+        // Query = preamble + bytes and remaining bits of the command word + cw_query
+        std::vector<float> ack_header, data_bytes;
+        int data_byte_offset[257];
+
+        void append_bits(std::vector<float> & burst, const int * bits, int n_bits) const;
+        void append_bits(std::vector<float> & burst, const std::vector<float> & bits) const;
+        int emit_bits(uint32_t bits, int n_bits, float * out) const;
+        int cw_length(const link_timing & link, int n_t1, int n_bits, int m) const;
+        static int copy(const std::vector<float> & burst, float * out);
+    };
+
+    // Query command word for emit_query, incl. CRC-5: DR (0 -> 8, 1 -> 64/3), M (1 FM0, 2/4/8 Miller),
+    // SL tags if select otherwise all, Session, Target and Q
+    RFID_API uint32_t query_word(bool select, int q, int m = 1, int dr = 0);
+
+  } // namespace rfid
+} // namespace gr
+
+#endif /* INCLUDED_RFID_WAVEFORM_CACHE_H */
@@ -8,11 +8,18 @@
 %include "rfid_swig_doc.i"
 
 %{
+#include "rfid/session.h"
 #include "rfid/reader.h"
 #include "rfid/gate.h"
 #include "rfid/tag_decoder.h"
 %}
 
+%include "rfid/session.h"
+%template(session_sptr) boost::shared_ptr<gr::rfid::session>;
+%pythoncode %{
+session = session.make;
+%}
+
 %include "rfid/reader.h"
 GR_SWIG_BLOCK_MAGIC2(rfid, reader);
 